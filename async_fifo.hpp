@@ -0,0 +1,244 @@
+/**
+ * @file async_fifo.hpp
+ * @brief C++20 coroutine push / pop on top of generic_fifo
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * co_await fifo.push (x) and co_await fifo.pop () complete without
+ * suspending whenever there is room or an element, so the fast path costs
+ * a generic_fifo insert or remove plus one fence and allocates nothing.
+ * Otherwise the awaiting coroutine's handle goes into the fifo's waiter
+ * slot for its side, one per side since there is one producer and one
+ * consumer, and the other side resumes it right after it made room or
+ * inserted an element. A thread can thus drive any number of fifos without
+ * polling them.
+ *
+ * The parking side stores its handle, issues a full fence and looks at the
+ * fifo again; the other side publishes its index, issues a full fence and
+ * looks at the waiter slot. Whichever comes second sees the other, so no
+ * wakeup is lost. A parked coroutine is resumed on the thread of the side
+ * that woke it, from inside that side's push or pop, and must not be
+ * destroyed while it is parked.
+ *
+ * Build with -std=c++20 (or later).
+ */
+
+#ifndef __ASYNC_FIFO_HPP__
+#define __ASYNC_FIFO_HPP__
+
+#include "generic_fifo.hpp"
+
+#if !defined(__cpp_impl_coroutine)
+#error "async_fifo.hpp needs C++20 coroutines"
+#endif
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief Generic Circular FIFO with awaitable insert and remove
+ *
+ * @tparam T: element's type
+ * @tparam N: fifo's capacity, must be a power of two
+ */
+template <typename T, std::size_t N> class async_fifo
+{
+public:
+  /**
+   * @brief Awaiter returned by push (), co_await yields nothing
+   */
+  class push_awaiter
+  {
+  public:
+    bool
+    await_ready ()
+    {
+      /* value_ is only moved from on success */
+      done_ = fifo_.try_push (std::move (value_));
+      return done_;
+    }
+
+    bool
+    await_suspend (std::coroutine_handle<> h) noexcept
+    {
+      /* once h is published this awaiter may be gone, capture no this */
+      return fifo_.park (fifo_.prod_waiter_, h,
+                         [&f = fifo_] { return !f.fifo_.full (); });
+    }
+
+    void
+    await_resume ()
+    {
+      /* woken by the consumer, the only one who makes room */
+      if (!done_)
+        fifo_.try_push (std::move (value_));
+    }
+
+  private:
+    friend class async_fifo;
+
+    template <typename U>
+    push_awaiter (async_fifo &fifo, U &&value)
+        : fifo_ (fifo), value_ (std::forward<U> (value)), done_ (false)
+    {
+    }
+
+    async_fifo &fifo_;
+    T value_;
+    bool done_;
+  };
+
+  /**
+   * @brief Awaiter returned by pop (), co_await yields the element
+   */
+  class pop_awaiter
+  {
+  public:
+    bool
+    await_ready ()
+    {
+      return fifo_.try_pop (value_);
+    }
+
+    bool
+    await_suspend (std::coroutine_handle<> h) noexcept
+    {
+      return fifo_.park (fifo_.cons_waiter_, h,
+                         [&f = fifo_] { return !f.fifo_.empty (); });
+    }
+
+    T
+    await_resume ()
+    {
+      /* woken by the producer, the only one who inserts */
+      if (!value_)
+        fifo_.try_pop (value_);
+      return std::move (*value_);
+    }
+
+  private:
+    friend class async_fifo;
+
+    explicit pop_awaiter (async_fifo &fifo) : fifo_ (fifo) {}
+
+    async_fifo &fifo_;
+    std::optional<T> value_;
+  };
+
+  async_fifo () noexcept : cons_waiter_ (nullptr), prod_waiter_ (nullptr) {}
+
+  async_fifo (const async_fifo &) = delete;
+  async_fifo &operator= (const async_fifo &) = delete;
+
+  /**
+   * @brief insert an element, suspending while fifo is full
+   *
+   * @param [in] value: element to copy or move in
+   */
+  template <typename U = T>
+  push_awaiter
+  push (U &&value)
+  {
+    return push_awaiter (*this, std::forward<U> (value));
+  }
+
+  /**
+   * @brief remove an element, suspending while fifo is empty
+   */
+  pop_awaiter
+  pop ()
+  {
+    return pop_awaiter (*this);
+  }
+
+  /**
+   * @brief insert an element without suspending
+   *
+   * Resumes a consumer parked in pop ().
+   *
+   * @param [in] value: element to copy or move in
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed, @p value is left alone
+   */
+  template <typename U>
+  bool
+  try_push (U &&value)
+  {
+    if (!fifo_.insert (std::forward<U> (value)))
+      return false;
+    wake (cons_waiter_);
+    return true;
+  }
+
+  /**
+   * @brief remove an element without suspending
+   *
+   * Resumes a producer parked in push ().
+   *
+   * @param [out] value: receives the element
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed
+   */
+  bool
+  try_pop (std::optional<T> &value)
+  {
+    if (!fifo_.consume (1, [&value] (T &v) { value.emplace (std::move (v)); }))
+      return false;
+    wake (prod_waiter_);
+    return true;
+  }
+
+  /**
+   * @brief return the underlying generic_fifo, e.g. for count ()
+   */
+  generic_fifo<T, N> &
+  get () noexcept
+  {
+    return fifo_;
+  }
+
+private:
+  /* publish h, then keep it only if ready () still says no */
+  template <typename F>
+  bool
+  park (std::atomic<void *> &waiter, std::coroutine_handle<> h,
+        F ready) noexcept
+  {
+    void *addr = h.address ();
+
+    /* release: the waker resumes a frame written up to here */
+    waiter.store (addr, std::memory_order_release);
+    std::atomic_thread_fence (std::memory_order_seq_cst);
+    if (!ready ())
+      return true;
+    /* lost the race against the other side's wake, which resumes h */
+    return waiter.exchange (nullptr, std::memory_order_acq_rel) != addr;
+  }
+
+  void
+  wake (std::atomic<void *> &waiter)
+  {
+    std::atomic_thread_fence (std::memory_order_seq_cst);
+    if (!waiter.load (std::memory_order_relaxed))
+      return;
+    void *addr = waiter.exchange (nullptr, std::memory_order_acq_rel);
+    if (addr)
+      std::coroutine_handle<>::from_address (addr).resume ();
+  }
+
+  generic_fifo<T, N> fifo_;
+
+  /* parked consumer and producer, each written by both sides */
+  alignas (GFIFO_CACHELINE_SIZE) std::atomic<void *> cons_waiter_;
+  alignas (GFIFO_CACHELINE_SIZE) std::atomic<void *> prod_waiter_;
+};
+
+#endif /* __ASYNC_FIFO_HPP__ */
@@ -0,0 +1,330 @@
+/**
+ * @file gfifo_bench.c
+ * @brief Microbenchmarks for the gfifo_* macros
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * Standalone harness, no dependency besides the C library and pthreads:
+ *
+ *   cc -O2 -D_GNU_SOURCE -I.. gfifo_bench.c -o gfifo_bench -lpthread
+ *
+ * Any gfifo.h mode may be added on the command line, e.g.
+ * -DGFIFO_CACHE_ALIGNED or -DGFIFO_FREE_RUNNING. GFIFO_SPSC is always
+ * enabled since the threaded tests need it.
+ *
+ * Built with -DGFIFO_ANY_SIZE the sweep also covers queues of 1000 and 3072
+ * elements; comparing its power of two rows with those of a default build
+ * gives the cost of the compare-and-subtract wrap over the mask.
+ *
+ * Usage: gfifo_bench [-o ops] [-c producer_cpu,consumer_cpu]
+ *
+ * Single threaded tests sweep element sizes from 4 B to 4 KiB and queue
+ * sizes from 64 to 1M elements (combinations above GFIFO_BENCH_MAX_BYTES
+ * are skipped) and report ns/op and Mops/s, one line per configuration:
+ *
+ *   test,elem_size,queue_size,ns_per_op,mops
+ *
+ * The threaded tests run one producer and one consumer, pinned with -c:
+ * spsc_stream measures one-way throughput and spsc_pingpong the one-way
+ * latency of a request/response round trip.
+ */
+
+#ifndef GFIFO_SPSC
+#define GFIFO_SPSC
+#endif
+
+#include "gfifo.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef GFIFO_BENCH_MAX_BYTES
+#define GFIFO_BENCH_MAX_BYTES (256UL << 20)
+#endif
+
+#define BENCH_BATCH 32
+
+static unsigned long bench_ops = 1UL << 24;
+static int bench_cpu[2] = { -1, -1 };
+
+static double
+bench_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+bench_report (const char *test, unsigned int elem, unsigned int size,
+              unsigned long ops, double ns)
+{
+  printf ("%s,%u,%u,%.2f,%.2f\n", test, elem, size, ns / ops, ops * 1e3 / ns);
+  fflush (stdout);
+}
+
+/* elements a test moves: fewer for big elements, never below 64K */
+static unsigned long
+bench_ops_for (unsigned int elem)
+{
+  unsigned long ops = bench_ops * 4 / elem;
+
+  return ops < (1UL << 16) ? (1UL << 16) : ops;
+}
+
+/*
+ * Each element size gets its own type and its own copy of the loops, so
+ * sizeof (_type) is a constant exactly as it is at a real call site.
+ */
+#define BENCH_DEFINE(_n)                                                      \
+  struct bench_elem##_n                                                       \
+  {                                                                           \
+    unsigned char b[_n];                                                      \
+  };                                                                          \
+                                                                              \
+  static double bench_single_##_n (struct gfifo *f, unsigned long ops)        \
+  {                                                                           \
+    static struct bench_elem##_n v[BENCH_BATCH];                              \
+    unsigned int burst = f->size / 2 < BENCH_BATCH ? f->size / 2              \
+                                                   : BENCH_BATCH;             \
+    unsigned long i, j;                                                       \
+    double t = bench_now ();                                                  \
+    for (i = 0; i < ops; i += burst)                                          \
+      {                                                                       \
+        for (j = 0; j < burst; j++)                                           \
+          gfifo_insert (f, &v[j], struct bench_elem##_n);                     \
+        for (j = 0; j < burst; j++)                                           \
+          gfifo_remove (f, &v[j], struct bench_elem##_n);                     \
+      }                                                                       \
+    __asm__ volatile ("" : : "r"(v) : "memory");                              \
+    return bench_now () - t;                                                  \
+  }                                                                           \
+                                                                              \
+  static double bench_array_##_n (struct gfifo *f, unsigned long ops)         \
+  {                                                                           \
+    static struct bench_elem##_n v[BENCH_BATCH];                              \
+    unsigned int burst = f->size / 2 < BENCH_BATCH ? f->size / 2              \
+                                                   : BENCH_BATCH;             \
+    unsigned long i;                                                          \
+    double t = bench_now ();                                                  \
+    for (i = 0; i < ops; i += burst)                                          \
+      {                                                                       \
+        gfifo_insert_array (f, v, burst, struct bench_elem##_n);              \
+        gfifo_remove_array (f, v, burst, struct bench_elem##_n);              \
+      }                                                                       \
+    __asm__ volatile ("" : : "r"(v) : "memory");                              \
+    return bench_now () - t;                                                  \
+  }
+
+BENCH_DEFINE (4)
+BENCH_DEFINE (8)
+BENCH_DEFINE (16)
+BENCH_DEFINE (64)
+BENCH_DEFINE (256)
+BENCH_DEFINE (1024)
+BENCH_DEFINE (4096)
+
+static const struct
+{
+  unsigned int elem;
+  double (*single) (struct gfifo *, unsigned long);
+  double (*array) (struct gfifo *, unsigned long);
+} bench_sizes[] = {
+  { 4, bench_single_4, bench_array_4 },
+  { 8, bench_single_8, bench_array_8 },
+  { 16, bench_single_16, bench_array_16 },
+  { 64, bench_single_64, bench_array_64 },
+  { 256, bench_single_256, bench_array_256 },
+  { 1024, bench_single_1024, bench_array_1024 },
+  { 4096, bench_single_4096, bench_array_4096 },
+};
+
+#ifdef GFIFO_ANY_SIZE
+/* descriptor ring like sizes next to their power of two neighbours */
+static const unsigned int bench_queues[]
+    = { 64, 1000, 1024, 3072, 4096, 16384, 262144, 1048576 };
+#else
+static const unsigned int bench_queues[]
+    = { 64, 1024, 16384, 262144, 1048576 };
+#endif
+
+static void
+bench_single_threaded (void)
+{
+  unsigned int i, j;
+
+  for (i = 0; i < sizeof (bench_sizes) / sizeof (bench_sizes[0]); i++)
+    for (j = 0; j < sizeof (bench_queues) / sizeof (bench_queues[0]); j++)
+      {
+        unsigned int elem = bench_sizes[i].elem;
+        unsigned int size = bench_queues[j];
+        unsigned long ops = bench_ops_for (elem);
+        struct gfifo f;
+        void *buf;
+
+        if ((unsigned long)elem * size > GFIFO_BENCH_MAX_BYTES)
+          continue;
+        buf = aligned_alloc (4096, (size_t)elem * size);
+        if (!buf)
+          continue;
+        memset (buf, 0, (size_t)elem * size);
+
+        gfifo_init (&f, buf, size);
+        bench_report ("insert_remove", elem, size, ops,
+                      bench_sizes[i].single (&f, ops));
+        gfifo_init (&f, buf, size);
+        bench_report ("insert_remove_array", elem, size, ops,
+                      bench_sizes[i].array (&f, ops));
+        free (buf);
+      }
+}
+
+static void
+bench_pin (int cpu)
+{
+  cpu_set_t set;
+
+  if (cpu < 0)
+    return;
+  CPU_ZERO (&set);
+  CPU_SET (cpu, &set);
+  pthread_setaffinity_np (pthread_self (), sizeof (set), &set);
+}
+
+#define BENCH_QUEUE 1024
+
+static struct gfifo bench_req, bench_rsp;
+static uint64_t bench_req_buf[BENCH_QUEUE], bench_rsp_buf[BENCH_QUEUE];
+
+static void *
+bench_stream_consumer (void *arg)
+{
+  unsigned long ops = *(unsigned long *)arg;
+  uint64_t v[BENCH_BATCH];
+  unsigned long n = 0;
+
+  bench_pin (bench_cpu[1]);
+  while (n < ops)
+    {
+      unsigned int k
+          = gfifo_remove_upto (&bench_req, v, BENCH_BATCH, uint64_t);
+      if (!k)
+        sched_yield ();
+      n += k;
+    }
+  return NULL;
+}
+
+static void
+bench_spsc_stream (void)
+{
+  unsigned long ops = bench_ops;
+  uint64_t v[BENCH_BATCH] = { 0 };
+  unsigned long n = 0;
+  pthread_t consumer;
+  double t;
+
+  gfifo_init (&bench_req, bench_req_buf, BENCH_QUEUE);
+  pthread_create (&consumer, NULL, bench_stream_consumer, &ops);
+  bench_pin (bench_cpu[0]);
+  t = bench_now ();
+  while (n < ops)
+    {
+      unsigned int k
+          = gfifo_insert_upto (&bench_req, v, BENCH_BATCH, uint64_t);
+      if (!k)
+        sched_yield ();
+      n += k;
+    }
+  pthread_join (consumer, NULL);
+  bench_report ("spsc_stream", sizeof (uint64_t), BENCH_QUEUE, ops,
+                bench_now () - t);
+}
+
+static void *
+bench_pingpong_echo (void *arg)
+{
+  unsigned long ops = *(unsigned long *)arg;
+  unsigned long n;
+  uint64_t v;
+
+  bench_pin (bench_cpu[1]);
+  for (n = 0; n < ops; n++)
+    {
+      while (!gfifo_remove (&bench_req, &v, uint64_t))
+        ;
+      while (!gfifo_insert (&bench_rsp, &v, uint64_t))
+        ;
+    }
+  return NULL;
+}
+
+static void
+bench_spsc_pingpong (void)
+{
+  unsigned long ops = bench_ops / 64;
+  unsigned long n;
+  pthread_t echo;
+  uint64_t v;
+  double t;
+
+  gfifo_init (&bench_req, bench_req_buf, BENCH_QUEUE);
+  gfifo_init (&bench_rsp, bench_rsp_buf, BENCH_QUEUE);
+  pthread_create (&echo, NULL, bench_pingpong_echo, &ops);
+  bench_pin (bench_cpu[0]);
+  t = bench_now ();
+  for (n = 0; n < ops; n++)
+    {
+      v = n;
+      while (!gfifo_insert (&bench_req, &v, uint64_t))
+        ;
+      while (!gfifo_remove (&bench_rsp, &v, uint64_t))
+        ;
+    }
+  pthread_join (echo, NULL);
+  /* one way latency is half of a round trip */
+  bench_report ("spsc_pingpong", sizeof (uint64_t), BENCH_QUEUE, ops * 2,
+                bench_now () - t);
+}
+
+int
+main (int argc, char **argv)
+{
+  int opt;
+
+  while ((opt = getopt (argc, argv, "o:c:")) != -1)
+    {
+      switch (opt)
+        {
+        case 'o':
+          bench_ops = strtoul (optarg, NULL, 0);
+          break;
+        case 'c':
+          if (sscanf (optarg, "%d,%d", &bench_cpu[0], &bench_cpu[1]) != 2)
+            {
+              fprintf (stderr, "-c expects producer_cpu,consumer_cpu\n");
+              return 1;
+            }
+          break;
+        default:
+          fprintf (stderr, "usage: %s [-o ops] [-c prod_cpu,cons_cpu]\n",
+                   argv[0]);
+          return 1;
+        }
+    }
+
+  printf ("test,elem_size,queue_size,ns_per_op,mops\n");
+  bench_single_threaded ();
+  bench_spsc_stream ();
+  if (sysconf (_SC_NPROCESSORS_ONLN) > 1)
+    bench_spsc_pingpong ();
+  return 0;
+}
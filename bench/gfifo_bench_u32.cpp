@@ -0,0 +1,244 @@
+/**
+ * @file gfifo_bench_u32.cpp
+ * @brief uint32_t fast path of generic_fifo against the gfifo_* macros
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ *   c++ -std=gnu++17 -O2 -D_GNU_SOURCE -I.. gfifo_bench_u32.cpp \
+ *       -o gfifo_bench_u32 -lpthread
+ *
+ * Usage: gfifo_bench_u32 [-o ops]
+ *
+ * Prints the same CSV as gfifo_bench. The insert and remove calls go
+ * through the out of line tpl_* and c_* functions below so that the single
+ * threaded numbers and the code they measure match. To see that code:
+ *
+ *   c++ -std=gnu++17 -O2 -D_GNU_SOURCE -I.. -S -o - gfifo_bench_u32.cpp
+ *
+ * g++ 12 on x86-64 emits, for generic_fifo<uint32_t, 1024> (capacity and
+ * mask are immediates, the element is one movl, the opposite index is only
+ * reloaded on the cold path):
+ *
+ *   tpl_insert_u32:                   tpl_remove_u32:
+ *     movq  (%rdi), %rax                movq  64(%rdi), %rax
+ *     movq  8(%rdi), %rdx               cmpq  72(%rdi), %rax
+ *     subq  %rax, %rdx                  je    .Lreload
+ *     cmpq  $-1024, %rdx                movq  %rax, %rdx
+ *     je    .Lreload                    addq  $1, %rax
+ *     movq  %rax, %rdx                  andl  $1023, %edx
+ *     addq  $1, %rax                    movl  128(%rdi,%rdx,4), %edx
+ *     andl  $1023, %edx                 movl  %edx, (%rsi)
+ *     movl  %esi, 128(%rdi,%rdx,4)      movq  %rax, 64(%rdi)
+ *     movq  %rax, (%rdi)                movl  $1, %eax
+ *     movl  $1, %eax                    ret
+ *     ret
+ *
+ * and for the gfifo_insert / gfifo_remove macros with GFIFO_SPSC, where
+ * @c data and @c mask are loaded from the struct and the opposite index
+ * on every call:
+ *
+ *   c_insert_u32:                     c_remove_u32:
+ *     movl  8(%rdi), %edx               movl  12(%rdi), %edx
+ *     movl  12(%rdi), %eax              movl  8(%rdi), %eax
+ *     subl  8(%rdi), %eax               subl  12(%rdi), %eax
+ *     subl  $1, %eax                    andl  20(%rdi), %eax
+ *     andl  20(%rdi), %eax              setne %al
+ *     setne %al                         movzbl %al, %eax
+ *     movzbl %al, %eax                  jne   .Lcopy
+ *     jne   .Lcopy                      ret
+ *     ret                             .Lcopy:
+ *   .Lcopy:                             movq  (%rdi), %rcx
+ *     movq  (%rdi), %rcx                movl  %edx, %r8d
+ *     movl  %edx, %r8d                  addl  $1, %edx
+ *     addl  $1, %edx                    movl  (%rcx,%r8,4), %ecx
+ *     movl  %esi, (%rcx,%r8,4)          movl  %ecx, (%rsi)
+ *     andl  20(%rdi), %edx              andl  20(%rdi), %edx
+ *     movl  %edx, 8(%rdi)               movl  %edx, 12(%rdi)
+ *     ret                               ret
+ */
+
+#ifndef GFIFO_SPSC
+#define GFIFO_SPSC
+#endif
+
+#include "generic_fifo.hpp"
+#include "gfifo.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define BENCH_QUEUE 1024
+#define BENCH_BATCH 32
+
+typedef generic_fifo<uint32_t, BENCH_QUEUE> bench_tpl_fifo;
+
+extern "C" __attribute__ ((noinline)) bool
+tpl_insert_u32 (bench_tpl_fifo &f, uint32_t v)
+{
+  return f.insert (v);
+}
+
+extern "C" __attribute__ ((noinline)) bool
+tpl_remove_u32 (bench_tpl_fifo &f, uint32_t &v)
+{
+  return f.remove (v);
+}
+
+extern "C" __attribute__ ((noinline)) unsigned int
+c_insert_u32 (struct gfifo *f, uint32_t v)
+{
+  return gfifo_insert (f, &v, uint32_t);
+}
+
+extern "C" __attribute__ ((noinline)) unsigned int
+c_remove_u32 (struct gfifo *f, uint32_t *v)
+{
+  return gfifo_remove (f, v, uint32_t);
+}
+
+static unsigned long bench_ops = 1UL << 26;
+
+static bench_tpl_fifo bench_tpl;
+static struct gfifo bench_c;
+static uint32_t bench_c_buf[BENCH_QUEUE];
+
+static double
+bench_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+bench_report (const char *test, unsigned long ops, double ns)
+{
+  printf ("%s,%zu,%u,%.2f,%.2f\n", test, sizeof (uint32_t), BENCH_QUEUE,
+          ns / ops, ops * 1e3 / ns);
+  fflush (stdout);
+}
+
+static void
+bench_single_threaded (void)
+{
+  unsigned long i, j;
+  uint32_t v = 0;
+  double t;
+
+  t = bench_now ();
+  for (i = 0; i < bench_ops; i += BENCH_BATCH)
+    {
+      for (j = 0; j < BENCH_BATCH; j++)
+        tpl_insert_u32 (bench_tpl, (uint32_t)j);
+      for (j = 0; j < BENCH_BATCH; j++)
+        tpl_remove_u32 (bench_tpl, v);
+    }
+  bench_report ("tpl_insert_remove", bench_ops, bench_now () - t);
+
+  gfifo_init (&bench_c, bench_c_buf, BENCH_QUEUE);
+  t = bench_now ();
+  for (i = 0; i < bench_ops; i += BENCH_BATCH)
+    {
+      for (j = 0; j < BENCH_BATCH; j++)
+        c_insert_u32 (&bench_c, (uint32_t)j);
+      for (j = 0; j < BENCH_BATCH; j++)
+        c_remove_u32 (&bench_c, &v);
+    }
+  bench_report ("c_insert_remove", bench_ops, bench_now () - t);
+  __asm__ volatile ("" : : "r"(v) : "memory");
+}
+
+static void *
+bench_tpl_consumer (void *)
+{
+  unsigned long n = 0;
+  uint32_t v;
+
+  while (n < bench_ops)
+    if (bench_tpl.remove (v))
+      n++;
+    else
+      sched_yield ();
+  return NULL;
+}
+
+static void *
+bench_c_consumer (void *)
+{
+  unsigned long n = 0;
+  uint32_t v;
+
+  while (n < bench_ops)
+    if (gfifo_remove (&bench_c, &v, uint32_t))
+      n++;
+    else
+      sched_yield ();
+  return NULL;
+}
+
+static void
+bench_spsc_stream (void)
+{
+  pthread_t consumer;
+  unsigned long n;
+  uint32_t v;
+  double t;
+
+  pthread_create (&consumer, NULL, bench_tpl_consumer, NULL);
+  t = bench_now ();
+  for (n = 0; n < bench_ops;)
+    {
+      v = (uint32_t)n;
+      if (bench_tpl.insert (v))
+        n++;
+      else
+        sched_yield ();
+    }
+  pthread_join (consumer, NULL);
+  bench_report ("tpl_spsc_stream", bench_ops, bench_now () - t);
+
+  gfifo_init (&bench_c, bench_c_buf, BENCH_QUEUE);
+  pthread_create (&consumer, NULL, bench_c_consumer, NULL);
+  t = bench_now ();
+  for (n = 0; n < bench_ops;)
+    {
+      v = (uint32_t)n;
+      if (gfifo_insert (&bench_c, &v, uint32_t))
+        n++;
+      else
+        sched_yield ();
+    }
+  pthread_join (consumer, NULL);
+  bench_report ("c_spsc_stream", bench_ops, bench_now () - t);
+}
+
+int
+main (int argc, char **argv)
+{
+  int opt;
+
+  while ((opt = getopt (argc, argv, "o:")) != -1)
+    {
+      switch (opt)
+        {
+        case 'o':
+          bench_ops = strtoul (optarg, NULL, 0);
+          break;
+        default:
+          fprintf (stderr, "usage: %s [-o ops]\n", argv[0]);
+          return 1;
+        }
+    }
+
+  printf ("test,elem_size,queue_size,ns_per_op,mops\n");
+  bench_single_threaded ();
+  bench_spsc_stream ();
+  return 0;
+}
@@ -0,0 +1,475 @@
+/**
+ * @file gfifo_stress.c
+ * @brief Concurrency stress and throughput regression check for the fifos
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * Standalone harness, no dependency besides the C library and pthreads:
+ *
+ *   cc -O2 -D_GNU_SOURCE -I.. gfifo_stress.c -o gfifo_stress -lpthread
+ *
+ * As for gfifo_bench, gfifo.h modes may be added on the command line.
+ * Build with -fsanitize=thread as well to have the interleavings checked
+ * for data races, and run it on a weakly ordered machine (ARM64, POWER)
+ * to catch a missing acquire or release that x86 would forgive.
+ *
+ * Usage: gfifo_stress [-o ops] [-q queue] [-p producers] [-c consumers]
+ *                     [-r runs] [-b baseline.csv] [-t percent]
+ *
+ * Runs the SPSC struct gfifo with gfifo_insert / gfifo_remove, with
+ * gfifo_insert_upto / gfifo_remove_upto, with gfifo_insert_array /
+ * gfifo_remove_array and with gfifo_peek / gfifo_peek_at / gfifo_throw,
+ * then struct gfifo_mpmc from -p producers and -c consumers. Both sides
+ * of the batch tests pick a random length of 1 to STRESS_BATCH elements
+ * per call, so transfers start at every offset and split at the wrap.
+ *
+ * Every producer sends @c ops messages tagged with its id and a sequence
+ * number. Consumers check each message's tag, that every producer's
+ * messages reach them in order, and that none arrives twice; at the end
+ * every message must have arrived once.
+ *
+ * Prints the best of -r runs per configuration:
+ *
+ *   test,producers,consumers,queue_size,ns_per_op,mops
+ *
+ * With -b, the output of an earlier run saved as a baseline, a
+ * configuration whose Mops/s is more than -t percent (default 10) below
+ * its baseline line is reported as a regression. The exit status is 1 if
+ * any message was lost, duplicated, reordered or corrupted or any
+ * configuration regressed, else 0.
+ */
+
+#ifndef GFIFO_SPSC
+#define GFIFO_SPSC
+#endif
+
+#include "gfifo.h"
+#include "gfifo_mpmc.h"
+
+#ifdef GFIFO_OVERWRITE
+#error "GFIFO_OVERWRITE drops elements by design, nothing to check"
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STRESS_BATCH 32
+#define STRESS_MAX_THREADS 64
+
+struct stress_msg
+{
+  uint32_t prod;
+  uint32_t seq;
+  uint64_t tag;
+};
+
+enum stress_kind
+{
+  STRESS_SINGLE,
+  STRESS_BATCH_OPS,
+  STRESS_ARRAY,
+  STRESS_PEEK,
+  STRESS_MPMC,
+};
+
+struct stress_result
+{
+  char test[32];
+  unsigned int producers;
+  unsigned int consumers;
+  unsigned int queue;
+  double mops;
+};
+
+static unsigned long stress_ops = 1UL << 20;
+static unsigned int stress_queue = 1024;
+static unsigned int stress_producers = 2;
+static unsigned int stress_consumers = 2;
+static unsigned int stress_batch_max; /* fits in any fifo of the size */
+
+/* state of the running configuration */
+static unsigned int stress_nr_prod;
+static struct gfifo stress_fifo;
+static struct gfifo_mpmc stress_mpmc;
+static struct stress_msg *stress_buf;
+static unsigned int *stress_seq;
+static uint64_t *stress_seen; /* one bit per message, per producer */
+static unsigned long stress_words;
+static unsigned long stress_received;
+static unsigned int stress_producing;
+static unsigned long stress_errors;
+
+static double
+stress_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* xorshift32 per thread, fixed seeds keep runs comparable */
+static unsigned int
+stress_len (unsigned int *state, unsigned int max)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return 1 + *state % max;
+}
+
+static uint64_t
+stress_tag (uint32_t prod, uint32_t seq)
+{
+  return (((uint64_t)prod << 32) | seq) * 0x9e3779b97f4a7c15ULL;
+}
+
+static void
+stress_fail (const char *what, const struct stress_msg *m)
+{
+  /* only print the first few, a broken fifo fails millions of times */
+  if (__atomic_fetch_add (&stress_errors, 1, __ATOMIC_RELAXED) < 8)
+    fprintf (stderr, "FAIL %s: producer %u seq %u tag %016llx\n", what,
+             m->prod, m->seq, (unsigned long long)m->tag);
+}
+
+/* last[] holds the consumer's last sequence number seen per producer */
+static void
+stress_check (const struct stress_msg *m, int64_t *last)
+{
+  uint64_t bit, *word;
+
+  if (m->prod >= stress_nr_prod || m->seq >= stress_ops
+      || m->tag != stress_tag (m->prod, m->seq))
+    {
+      stress_fail ("corrupt", m);
+      return;
+    }
+  if ((int64_t)m->seq <= last[m->prod])
+    stress_fail ("out of order", m);
+  last[m->prod] = m->seq;
+
+  bit = 1ULL << (m->seq % 64);
+  word = &stress_seen[m->prod * stress_words + m->seq / 64];
+  if (__atomic_fetch_or (word, bit, __ATOMIC_RELAXED) & bit)
+    stress_fail ("duplicate", m);
+}
+
+static int
+stress_done (void)
+{
+  return __atomic_load_n (&stress_received, __ATOMIC_RELAXED)
+         >= stress_nr_prod * stress_ops;
+}
+
+static void
+stress_got (unsigned long n)
+{
+  __atomic_fetch_add (&stress_received, n, __ATOMIC_RELAXED);
+}
+
+static void *
+stress_producer (void *arg)
+{
+  enum stress_kind kind = (enum stress_kind)((uintptr_t)arg >> 8);
+  uint32_t id = (uint32_t)((uintptr_t)arg & 0xff);
+  struct stress_msg batch[STRESS_BATCH];
+  unsigned long seq = 0;
+  unsigned int i, n, done, rnd = 0x9e3779b9u;
+
+  while (seq < stress_ops)
+    {
+      if (kind == STRESS_BATCH_OPS || kind == STRESS_ARRAY)
+        {
+          n = stress_len (&rnd, stress_batch_max);
+          if (n > stress_ops - seq)
+            n = stress_ops - seq;
+          for (i = 0; i < n; i++)
+            {
+              batch[i].prod = id;
+              batch[i].seq = seq + i;
+              batch[i].tag = stress_tag (id, seq + i);
+            }
+          for (done = 0; done < n;)
+            {
+              if (kind == STRESS_ARRAY)
+                i = gfifo_insert_array (&stress_fifo, batch, n,
+                                        struct stress_msg)
+                        ? n
+                        : 0;
+              else
+                i = gfifo_insert_upto (&stress_fifo, batch + done, n - done,
+                                       struct stress_msg);
+              if (!i)
+                sched_yield ();
+              done += i;
+            }
+          seq += n;
+          continue;
+        }
+
+      batch[0].prod = id;
+      batch[0].seq = seq;
+      batch[0].tag = stress_tag (id, seq);
+      if (kind == STRESS_MPMC
+              ? gfifo_mpmc_insert (&stress_mpmc, batch, struct stress_msg)
+              : gfifo_insert (&stress_fifo, batch, struct stress_msg))
+        seq++;
+      else
+        sched_yield ();
+    }
+  __atomic_fetch_sub (&stress_producing, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+static void *
+stress_consumer (void *arg)
+{
+  enum stress_kind kind = (enum stress_kind)(uintptr_t)arg;
+  struct stress_msg batch[STRESS_BATCH], next;
+  int64_t last[STRESS_MAX_THREADS];
+  unsigned int i, n, finished = 0, rnd = 0x85ebca6bu;
+
+  for (i = 0; i < STRESS_MAX_THREADS; i++)
+    last[i] = -1;
+
+  while (!stress_done ())
+    {
+      switch (kind)
+        {
+        case STRESS_SINGLE:
+          n = gfifo_remove (&stress_fifo, batch, struct stress_msg);
+          break;
+        case STRESS_BATCH_OPS:
+          n = gfifo_remove_upto (&stress_fifo, batch,
+                                 stress_len (&rnd, stress_batch_max),
+                                 struct stress_msg);
+          break;
+        case STRESS_ARRAY:
+          /* all or nothing: once the producer is done, drain one by one */
+          n = finished ? 1 : stress_len (&rnd, stress_batch_max);
+          if (!gfifo_remove_array (&stress_fifo, batch, n, struct stress_msg))
+            n = 0;
+          break;
+        case STRESS_PEEK:
+          n = gfifo_peek (&stress_fifo, batch, struct stress_msg);
+          /* one producer, so the element behind it is the next one */
+          if (n && gfifo_peek_at (&stress_fifo, &next, 1, struct stress_msg)
+              && (next.seq != batch[0].seq + 1
+                  || next.tag != stress_tag (next.prod, next.seq)))
+            stress_fail ("peek_at", &next);
+          if (n)
+            gfifo_throw (&stress_fifo, struct stress_msg);
+          break;
+        default:
+          n = gfifo_mpmc_remove (&stress_mpmc, batch, struct stress_msg);
+          break;
+        }
+      if (!n)
+        {
+          /* everything was published before this remove: a lost message
+             would otherwise keep the consumers spinning forever */
+          if (finished)
+            break;
+          finished = !__atomic_load_n (&stress_producing, __ATOMIC_ACQUIRE);
+          sched_yield ();
+          continue;
+        }
+      for (i = 0; i < n; i++)
+        stress_check (&batch[i], last);
+      stress_got (n);
+    }
+  return NULL;
+}
+
+static double
+stress_run (enum stress_kind kind, unsigned int producers,
+            unsigned int consumers)
+{
+  pthread_t threads[2 * STRESS_MAX_THREADS];
+  unsigned long p, w, missing = 0;
+  unsigned int i;
+  double t;
+
+  stress_nr_prod = producers;
+  stress_words = (stress_ops + 63) / 64;
+  memset (stress_seen, 0, producers * stress_words * sizeof (uint64_t));
+  stress_received = 0;
+  stress_producing = producers;
+  if (kind == STRESS_MPMC)
+    gfifo_mpmc_init (&stress_mpmc, stress_buf, stress_seq, stress_queue);
+  else
+    gfifo_init (&stress_fifo, stress_buf, stress_queue);
+
+  t = stress_now ();
+  for (i = 0; i < consumers; i++)
+    pthread_create (&threads[i], NULL, stress_consumer,
+                    (void *)(uintptr_t)kind);
+  for (i = 0; i < producers; i++)
+    pthread_create (&threads[consumers + i], NULL, stress_producer,
+                    (void *)(((uintptr_t)kind << 8) | i));
+  for (i = 0; i < consumers + producers; i++)
+    pthread_join (threads[i], NULL);
+  t = stress_now () - t;
+
+  for (p = 0; p < producers; p++)
+    for (w = 0; w < stress_words; w++)
+      {
+        uint64_t want = w == stress_words - 1 && stress_ops % 64
+                            ? (1ULL << (stress_ops % 64)) - 1
+                            : ~0ULL;
+        missing += __builtin_popcountll (stress_seen[p * stress_words + w]
+                                         ^ want);
+      }
+  if (missing)
+    {
+      fprintf (stderr, "FAIL lost: %lu messages never arrived\n", missing);
+      stress_errors++;
+    }
+  return producers * stress_ops * 1e3 / t;
+}
+
+/* return 1 if r is more than pct percent slower than its baseline line */
+static int
+stress_regressed (const char *baseline, const struct stress_result *r,
+                  double pct)
+{
+  struct stress_result b;
+  char line[256];
+  double ns;
+  int found = 0;
+  FILE *f;
+
+  f = fopen (baseline, "r");
+  if (!f)
+    {
+      perror (baseline);
+      return 1;
+    }
+  while (!found && fgets (line, sizeof (line), f))
+    if (sscanf (line, "%31[^,],%u,%u,%u,%lf,%lf", b.test, &b.producers,
+                &b.consumers, &b.queue, &ns, &b.mops)
+            == 6
+        && !strcmp (b.test, r->test) && b.producers == r->producers
+        && b.consumers == r->consumers && b.queue == r->queue)
+      found = 1;
+  fclose (f);
+  if (!found || r->mops >= b.mops * (1 - pct / 100))
+    return 0;
+  fprintf (stderr, "REGRESSION %s: %.2f Mops/s, baseline %.2f\n", r->test,
+           r->mops, b.mops);
+  return 1;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const struct
+  {
+    const char *name;
+    enum stress_kind kind;
+  } tests[] = {
+    { "spsc_single", STRESS_SINGLE },
+    { "spsc_batch", STRESS_BATCH_OPS },
+    { "spsc_array", STRESS_ARRAY },
+    { "spsc_peek", STRESS_PEEK },
+    { "mpmc", STRESS_MPMC },
+  };
+  const char *baseline = NULL;
+  double pct = 10, mops;
+  unsigned int runs = 3, i, r;
+  int opt, bad = 0;
+
+  while ((opt = getopt (argc, argv, "o:q:p:c:r:b:t:")) != -1)
+    {
+      switch (opt)
+        {
+        case 'o':
+          stress_ops = strtoul (optarg, NULL, 0);
+          break;
+        case 'q':
+          stress_queue = strtoul (optarg, NULL, 0);
+          break;
+        case 'p':
+          stress_producers = strtoul (optarg, NULL, 0);
+          break;
+        case 'c':
+          stress_consumers = strtoul (optarg, NULL, 0);
+          break;
+        case 'r':
+          runs = strtoul (optarg, NULL, 0);
+          break;
+        case 'b':
+          baseline = optarg;
+          break;
+        case 't':
+          pct = strtod (optarg, NULL);
+          break;
+        default:
+          fprintf (stderr,
+                   "usage: %s [-o ops] [-q queue] [-p producers] "
+                   "[-c consumers] [-r runs] [-b baseline.csv] "
+                   "[-t percent]\n",
+                   argv[0]);
+          return 1;
+        }
+    }
+  if (!stress_ops || stress_ops > UINT32_MAX || !stress_producers
+      || !stress_consumers || stress_producers > STRESS_MAX_THREADS
+      || stress_consumers > STRESS_MAX_THREADS || !runs
+      || (stress_queue & (stress_queue - 1)) || stress_queue < 2)
+    {
+      fprintf (stderr, "bad arguments, queue must be a power of two and at "
+                       "most %u producers and consumers\n",
+               STRESS_MAX_THREADS);
+      return 1;
+    }
+
+  /* an all or nothing insert_array must fit even without a free slot */
+  stress_batch_max = stress_queue - 1 < STRESS_BATCH ? stress_queue - 1
+                                                     : STRESS_BATCH;
+  stress_buf = (struct stress_msg *)malloc (stress_queue
+                                            * sizeof (struct stress_msg));
+  stress_seq = (unsigned int *)malloc (stress_queue * sizeof (unsigned int));
+  stress_seen = (uint64_t *)malloc (stress_producers * ((stress_ops + 63) / 64)
+                                    * sizeof (uint64_t));
+  if (!stress_buf || !stress_seq || !stress_seen)
+    {
+      perror ("malloc");
+      return 1;
+    }
+
+  printf ("test,producers,consumers,queue_size,ns_per_op,mops\n");
+  for (i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+    {
+      struct stress_result res;
+
+      memset (&res, 0, sizeof (res));
+      strcpy (res.test, tests[i].name);
+      res.producers = tests[i].kind == STRESS_MPMC ? stress_producers : 1;
+      res.consumers = tests[i].kind == STRESS_MPMC ? stress_consumers : 1;
+      res.queue = stress_queue;
+      for (r = 0; r < runs; r++)
+        {
+          mops = stress_run (tests[i].kind, res.producers, res.consumers);
+          if (mops > res.mops)
+            res.mops = mops;
+        }
+      printf ("%s,%u,%u,%u,%.2f,%.2f\n", res.test, res.producers,
+              res.consumers, res.queue, 1e3 / res.mops, res.mops);
+      fflush (stdout);
+      if (baseline)
+        bad |= stress_regressed (baseline, &res, pct);
+    }
+
+  if (stress_errors)
+    fprintf (stderr, "FAIL %lu errors\n", stress_errors);
+  return stress_errors || bad;
+}
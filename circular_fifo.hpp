@@ -0,0 +1,450 @@
+/**
+ * @file circular_fifo.hpp
+ * @brief CircularFifo.cs semantics on top of struct gfifo
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * C++ counterpart of the C# CircularFifo<T>: Insert, Remove, GetValue,
+ * GetAll, RemoveAll and Clear map to insert, remove, get_value, view /
+ * copy_all, remove_all and clear. The fifo is a struct gfifo over a caller
+ * supplied buffer, so the gfifo.h modes apply and nothing is allocated
+ * after construction: indexing is an add-and-mask instead of a modulo,
+ * view () returns a range over the current contents without copying, and
+ * copy_all / remove_all move everything with at most two memcpy.
+ *
+ * T must be trivially copyable, as for the gfifo_* macros. The macros use
+ * typeof, so build with -std=gnu++17 (or another gnu++ dialect).
+ */
+
+#ifndef __CIRCULAR_FIFO_HPP__
+#define __CIRCULAR_FIFO_HPP__
+
+#include "gfifo.h"
+
+#ifdef GFIFO_OVERWRITE
+#error "circular_fifo peeks at slots the producer may overwrite"
+#endif
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+/**
+ * @brief Circular FIFO over a caller supplied buffer
+ *
+ * @tparam T: element's type
+ */
+template <typename T> class circular_fifo
+{
+  static_assert (std::is_trivially_copyable<T>::value,
+                 "struct gfifo copies elements with memcpy");
+
+public:
+  /**
+   * @brief Random access iterator over a view, see view ()
+   */
+  class const_iterator
+  {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T *pointer;
+    typedef const T &reference;
+
+    const_iterator () noexcept : data_ (nullptr), wrap_ (0), pos_ (0) {}
+
+    reference
+    operator* () const noexcept
+    {
+      return data_[slot (pos_)];
+    }
+
+    pointer
+    operator->() const noexcept
+    {
+      return &data_[slot (pos_)];
+    }
+
+    reference
+    operator[] (difference_type n) const noexcept
+    {
+      return data_[slot (pos_ + n)];
+    }
+
+    const_iterator &
+    operator++ () noexcept
+    {
+      pos_++;
+      return *this;
+    }
+
+    const_iterator
+    operator++ (int) noexcept
+    {
+      const_iterator it = *this;
+      pos_++;
+      return it;
+    }
+
+    const_iterator &
+    operator-- () noexcept
+    {
+      pos_--;
+      return *this;
+    }
+
+    const_iterator
+    operator-- (int) noexcept
+    {
+      const_iterator it = *this;
+      pos_--;
+      return it;
+    }
+
+    const_iterator &
+    operator+= (difference_type n) noexcept
+    {
+      pos_ += n;
+      return *this;
+    }
+
+    const_iterator &
+    operator-= (difference_type n) noexcept
+    {
+      pos_ -= n;
+      return *this;
+    }
+
+    friend const_iterator
+    operator+ (const_iterator it, difference_type n) noexcept
+    {
+      return it += n;
+    }
+
+    friend const_iterator
+    operator+ (difference_type n, const_iterator it) noexcept
+    {
+      return it += n;
+    }
+
+    friend const_iterator
+    operator- (const_iterator it, difference_type n) noexcept
+    {
+      return it -= n;
+    }
+
+    friend difference_type
+    operator- (const const_iterator &a, const const_iterator &b) noexcept
+    {
+      return static_cast<difference_type> (a.pos_ - b.pos_);
+    }
+
+    friend bool
+    operator== (const const_iterator &a, const const_iterator &b) noexcept
+    {
+      return a.pos_ == b.pos_;
+    }
+
+    friend bool
+    operator!= (const const_iterator &a, const const_iterator &b) noexcept
+    {
+      return a.pos_ != b.pos_;
+    }
+
+    friend bool
+    operator< (const const_iterator &a, const const_iterator &b) noexcept
+    {
+      return a - b < 0;
+    }
+
+    friend bool
+    operator> (const const_iterator &a, const const_iterator &b) noexcept
+    {
+      return b < a;
+    }
+
+    friend bool
+    operator<= (const const_iterator &a, const const_iterator &b) noexcept
+    {
+      return !(b < a);
+    }
+
+    friend bool
+    operator>= (const const_iterator &a, const const_iterator &b) noexcept
+    {
+      return !(a < b);
+    }
+
+  private:
+    friend class circular_fifo;
+
+    const_iterator (const T *data, std::size_t wrap, std::size_t pos) noexcept
+        : data_ (data), wrap_ (wrap), pos_ (pos)
+    {
+    }
+
+    /* pos_ starts below size and moves by at most size */
+    std::size_t
+    slot (std::size_t pos) const noexcept
+    {
+#ifdef GFIFO_ANY_SIZE
+      return pos >= wrap_ ? pos - wrap_ : pos;
+#else
+      return pos & wrap_;
+#endif
+    }
+
+    const T *data_;
+    std::size_t wrap_; /* mask, or size with GFIFO_ANY_SIZE */
+    std::size_t pos_;  /* not wrapped, so end () - begin () is the count */
+  };
+
+  /**
+   * @brief The elements stored when view () was called, oldest first
+   *
+   * Stays valid until the consumer removes elements; elements the producer
+   * inserts later are not part of it.
+   */
+  class view_type
+  {
+  public:
+    const_iterator
+    begin () const noexcept
+    {
+      return begin_;
+    }
+
+    const_iterator
+    end () const noexcept
+    {
+      return begin_ + static_cast<std::ptrdiff_t> (size_);
+    }
+
+    std::size_t
+    size () const noexcept
+    {
+      return size_;
+    }
+
+    bool
+    empty () const noexcept
+    {
+      return size_ == 0;
+    }
+
+    const T &
+    operator[] (std::size_t i) const noexcept
+    {
+      return begin_[static_cast<std::ptrdiff_t> (i)];
+    }
+
+  private:
+    friend class circular_fifo;
+
+    view_type (const_iterator begin, std::size_t size) noexcept
+        : begin_ (begin), size_ (size)
+    {
+    }
+
+    const_iterator begin_;
+    std::size_t size_;
+  };
+
+  /**
+   * @brief use @p buf as storage
+   *
+   * @param [in] buf: fifo's buffer of @p size elements
+   * @param [in] size: fifo's size, a power of two unless GFIFO_ANY_SIZE
+   */
+  circular_fifo (T *buf, unsigned int size) noexcept
+  {
+    gfifo_init (&fifo_, buf, size);
+  }
+
+  circular_fifo (const circular_fifo &) = delete;
+  circular_fifo &operator= (const circular_fifo &) = delete;
+
+  /**
+   * @brief return fifo's capacity
+   */
+  std::size_t
+  capacity () const noexcept
+  {
+    return __gfifo_capacity (&fifo_);
+  }
+
+  /**
+   * @brief return number of element in fifo
+   */
+  std::size_t
+  count () const noexcept
+  {
+    return gfifo_vaild_count (&fifo_);
+  }
+
+  /**
+   * @brief return number of free slots in fifo
+   */
+  std::size_t
+  unused_count () const noexcept
+  {
+    return capacity () - count ();
+  }
+
+  /**
+   * @brief return true if fifo is full
+   */
+  bool
+  full () const noexcept
+  {
+    return gfifo_full (&fifo_);
+  }
+
+  /**
+   * @brief return true if fifo is empty
+   */
+  bool
+  empty () const noexcept
+  {
+    return gfifo_empty (&fifo_);
+  }
+
+  /**
+   * @brief insert an element into fifo
+   *
+   * @param [in] item: element to copy in
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed
+   */
+  bool
+  insert (const T &item) noexcept
+  {
+    return gfifo_insert (&fifo_, &item, T);
+  }
+
+  /**
+   * @brief remove an element from fifo
+   *
+   * @param [out] item: receives the element
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed
+   */
+  bool
+  remove (T &item) noexcept
+  {
+    return gfifo_remove (&fifo_, &item, T);
+  }
+
+  /**
+   * @brief remove an element without saving
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed
+   */
+  bool
+  remove () noexcept
+  {
+    return gfifo_throw (&fifo_, T);
+  }
+
+  /**
+   * @brief get the element at a position without removing
+   *
+   * @param [out] item: receives a copy of the element
+   * @param [in] index: position counted from the oldest element
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed, @p index is not below count ()
+   */
+  bool
+  get_value (T &item, std::size_t index) noexcept
+  {
+    return index < capacity () && gfifo_peek_at (&fifo_, &item, index, T);
+  }
+
+  /**
+   * @brief get the stored elements without copying or removing them
+   */
+  view_type
+  view () noexcept
+  {
+    std::size_t n = __gfifo_cons_count (&fifo_, capacity ());
+    const_iterator begin (static_cast<const T *> (__gfifo_data (&fifo_)),
+                          wrap (), __gfifo_idx (&fifo_, fifo_.out));
+    return view_type (begin, n);
+  }
+
+  /**
+   * @brief copy the stored elements without removing them
+   *
+   * @param [out] array: receives up to @p len elements, oldest first
+   * @param [in] len: array's size
+   *
+   * @retval: number of elements copied
+   */
+  std::size_t
+  copy_all (T *array, std::size_t len) noexcept
+  {
+    std::size_t n = __gfifo_cons_count (&fifo_, capacity ());
+    if (n > len)
+      n = len;
+    __gfifo_copy_out (&fifo_, __gfifo_idx (&fifo_, fifo_.out), array,
+                      (unsigned int)n, T);
+    return n;
+  }
+
+  /**
+   * @brief remove the stored elements
+   *
+   * @param [out] array: receives up to @p len elements, oldest first
+   * @param [in] len: array's size
+   *
+   * @retval: number of elements removed
+   */
+  std::size_t
+  remove_all (T *array, std::size_t len) noexcept
+  {
+    return gfifo_remove_upto (&fifo_, array, (unsigned int)len, T);
+  }
+
+  /**
+   * @brief remove every stored element without saving
+   */
+  void
+  clear () noexcept
+  {
+    gfifo_release_n (&fifo_, (unsigned int)count ());
+  }
+
+  /**
+   * @brief return the underlying struct gfifo, for the gfifo_* macros
+   */
+  struct gfifo *
+  get () noexcept
+  {
+    return &fifo_;
+  }
+
+private:
+  std::size_t
+  wrap () const noexcept
+  {
+#ifdef GFIFO_ANY_SIZE
+    return fifo_.size;
+#else
+    return fifo_.mask;
+#endif
+  }
+
+  struct gfifo fifo_;
+};
+
+#endif /* __CIRCULAR_FIFO_HPP__ */
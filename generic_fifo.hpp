@@ -0,0 +1,406 @@
+/**
+ * @file generic_fifo.hpp
+ * @brief Type-safe circular queue template
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * C++ counterpart of the gfifo_* macros. The element type and the capacity
+ * are template parameters, so there is no @c _type to get wrong at each call
+ * site and @c mask is a compile-time constant. Elements are constructed in
+ * place with placement new and moved out on remove, so any movable type can
+ * be stored, including move-only ones such as std::unique_ptr; trivially
+ * copyable types still compile down to plain stores. Elements dropped,
+ * cleared or left over at destruction are destroyed, a whole run at a
+ * time, and not at all for trivially destructible types.
+ *
+ * One producer thread and one consumer thread may use a fifo concurrently,
+ * with the same acquire/release index publication as GFIFO_SPSC and the
+ * same cached opposite index as GFIFO_CACHE_ALIGNED. For small trivially
+ * copyable types such as uint32_t, insert and remove then compile to one
+ * store or load of the element plus an add-and-mask of the own index, see
+ * bench/gfifo_bench_u32.cpp.
+ *
+ * Unlike struct gfifo, @c in and @c out are free running, so all @c N slots
+ * can be used.
+ */
+
+#ifndef __GENERIC_FIFO_HPP__
+#define __GENERIC_FIFO_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef GFIFO_CACHELINE_SIZE
+#define GFIFO_CACHELINE_SIZE 64
+#endif
+
+/**
+ * @brief Generic Circular FIFO
+ *
+ * @tparam T: element's type
+ * @tparam N: fifo's capacity, must be a power of two
+ */
+template <typename T, std::size_t N> class generic_fifo
+{
+  static_assert (N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+  generic_fifo () noexcept : in_ (0), out_cache_ (0), out_ (0), in_cache_ (0)
+  {
+  }
+
+  ~generic_fifo () { clear (); }
+
+  generic_fifo (const generic_fifo &) = delete;
+  generic_fifo &operator= (const generic_fifo &) = delete;
+
+  /**
+   * @brief return fifo's capacity
+   */
+  static constexpr std::size_t
+  capacity () noexcept
+  {
+    return N;
+  }
+
+  /**
+   * @brief return true if fifo is empty
+   */
+  bool
+  empty () const noexcept
+  {
+    return in_.load (std::memory_order_acquire)
+           == out_.load (std::memory_order_acquire);
+  }
+
+  /**
+   * @brief return true if fifo is full
+   */
+  bool
+  full () const noexcept
+  {
+    return count () == N;
+  }
+
+  /**
+   * @brief return number of element in fifo
+   */
+  std::size_t
+  count () const noexcept
+  {
+    std::size_t out = out_.load (std::memory_order_acquire);
+    return in_.load (std::memory_order_acquire) - out;
+  }
+
+  /**
+   * @brief insert an element into fifo
+   *
+   * @param [in] value: element to copy in
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed
+   */
+  bool
+  insert (const T &value)
+  {
+    return emplace (value);
+  }
+
+  /**
+   * @brief insert an element into fifo
+   *
+   * @param [in] value: element to move in
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed
+   */
+  bool
+  insert (T &&value)
+  {
+    return emplace (std::move (value));
+  }
+
+  /**
+   * @brief remove an element from fifo
+   *
+   * @param [out] value: receives the element by move assignment
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed
+   */
+  bool
+  remove (T &value)
+  {
+    std::size_t out = out_.load (std::memory_order_relaxed);
+    if (!readable (out, 1))
+      return false;
+    T *p = slot (out);
+    value = std::move (*p);
+    p->~T ();
+    out_.store (out + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief get an element data without removing
+   *
+   * @param [out] value: receives a copy of the oldest element
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed
+   */
+  bool
+  peek (T &value) const
+  {
+    std::size_t out = out_.load (std::memory_order_relaxed);
+    if (!readable (out, 1))
+      return false;
+    value = *slot (out);
+    return true;
+  }
+
+  /**
+   * @brief remove an element without saving
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed
+   */
+  bool
+  drop () noexcept
+  {
+    std::size_t out = out_.load (std::memory_order_relaxed);
+    if (!readable (out, 1))
+      return false;
+    slot (out)->~T ();
+    out_.store (out + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief remove number of element without saving
+   *
+   * Destroys the oldest @p len elements, or all of them if fewer are
+   * stored, and publishes @c out once.
+   *
+   * @param [in] len: maximum number of elements
+   *
+   * @retval: number of elements removed
+   */
+  std::size_t
+  drop (std::size_t len) noexcept
+  {
+    std::size_t out = out_.load (std::memory_order_relaxed);
+    if (!readable (out, len))
+      len = in_cache_ - out;
+    destroy (out, len);
+    out_.store (out + len, std::memory_order_release);
+    return len;
+  }
+
+  /**
+   * @brief remove every element without saving
+   */
+  void
+  clear () noexcept
+  {
+    drop (N);
+  }
+
+  /**
+   * @brief insert number of element into fifo
+   *
+   * Either all @p len elements are inserted or none, also when copying one
+   * throws: the copies already made are destroyed and the exception is
+   * passed on.
+   *
+   * @param [in] array: elements to copy in
+   * @param [in] len: number of elements
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed
+   */
+  bool
+  insert_array (const T *array, std::size_t len)
+  {
+    std::size_t in = in_.load (std::memory_order_relaxed);
+    if (!writable (in, len))
+      return false;
+    if constexpr (std::is_trivially_copyable_v<T>)
+      {
+        std::size_t first = std::min (len, N - (in & mask));
+        std::memcpy (slot (in), array, sizeof (T) * first);
+        std::memcpy (slot (0), array + first, sizeof (T) * (len - first));
+      }
+    else
+      {
+        /* each call destroys what it built if a copy throws */
+        std::size_t first = std::min (len, N - (in & mask));
+        std::uninitialized_copy_n (array, first, slot (in));
+        try
+          {
+            std::uninitialized_copy_n (array + first, len - first, slot (0));
+          }
+        catch (...)
+          {
+            std::destroy_n (slot (in), first);
+            throw;
+          }
+      }
+    in_.store (in + len, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief remove number of element from fifo
+   *
+   * Either all @p len elements are removed or none.
+   *
+   * If a move assignment throws, the exception is passed on and nothing is
+   * removed; elements already moved from stay in the fifo.
+   *
+   * @param [out] array: receives the elements by move assignment
+   * @param [in] len: number of elements
+   *
+   * @retval:
+   *    \li true: success
+   *    \li false: failed
+   */
+  bool
+  remove_array (T *array, std::size_t len)
+  {
+    std::size_t out = out_.load (std::memory_order_relaxed);
+    if (!readable (out, len))
+      return false;
+    if constexpr (std::is_trivially_copyable_v<T>)
+      {
+        std::size_t first = std::min (len, N - (out & mask));
+        std::memcpy (array, slot (out), sizeof (T) * first);
+        std::memcpy (array + first, slot (0), sizeof (T) * (len - first));
+      }
+    else
+      {
+        /* destroy only once all moved, a throw leaves every slot live */
+        for (std::size_t i = 0; i < len; i++)
+          array[i] = std::move (*slot (out + i));
+        destroy (out, len);
+      }
+    out_.store (out + len, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief process up to number of element in place, then remove them
+   *
+   * Reads @c in once, calls @p fn (T &) on each of the up to @p max oldest
+   * elements, across both wrap runs, destroys them and publishes @c out
+   * once at the end.
+   *
+   * @param [in] max: maximum number of elements
+   * @param [in] fn: visitor
+   *
+   * @retval: number of elements consumed
+   */
+  template <typename F>
+  std::size_t
+  consume (std::size_t max, F &&fn)
+  {
+    std::size_t out = out_.load (std::memory_order_relaxed);
+    if (!readable (out, max))
+      max = in_cache_ - out;
+    std::size_t first = std::min (max, N - (out & mask));
+    T *p = slot (out);
+    for (std::size_t i = 0; i < first; i++)
+      fn (p[i]);
+    p = slot (0);
+    for (std::size_t i = 0; i < max - first; i++)
+      fn (p[i]);
+    destroy (out, max);
+    out_.store (out + max, std::memory_order_release);
+    return max;
+  }
+
+private:
+  static constexpr std::size_t mask = N - 1;
+
+  template <typename... Args>
+  bool
+  emplace (Args &&...args)
+  {
+    std::size_t in = in_.load (std::memory_order_relaxed);
+    if (!writable (in, 1))
+      return false;
+    ::new (static_cast<void *> (slot (in))) T (std::forward<Args> (args)...);
+    in_.store (in + 1, std::memory_order_release);
+    return true;
+  }
+
+  /* producer: room for len more, reload @c out only if the cache says no */
+  bool
+  writable (std::size_t in, std::size_t len) noexcept
+  {
+    if (N - (in - out_cache_) >= len)
+      return true;
+    out_cache_ = out_.load (std::memory_order_acquire);
+    return N - (in - out_cache_) >= len;
+  }
+
+  /* consumer: len elements stored, reload @c in only if the cache says no */
+  bool
+  readable (std::size_t out, std::size_t len) const noexcept
+  {
+    if (in_cache_ - out >= len)
+      return true;
+    in_cache_ = in_.load (std::memory_order_acquire);
+    return in_cache_ - out >= len;
+  }
+
+  /* destroy len elements from out on, as at most two contiguous runs */
+  void
+  destroy (std::size_t out, std::size_t len) noexcept
+  {
+    if constexpr (!std::is_trivially_destructible_v<T>)
+      {
+        std::size_t first = std::min (len, N - (out & mask));
+        std::destroy_n (slot (out), first);
+        std::destroy_n (slot (0), len - first);
+      }
+  }
+
+  T *
+  slot (std::size_t i) noexcept
+  {
+    return std::launder (reinterpret_cast<T *> (data_) + (i & mask));
+  }
+
+  const T *
+  slot (std::size_t i) const noexcept
+  {
+    return std::launder (reinterpret_cast<const T *> (data_) + (i & mask));
+  }
+
+  /* producer side */
+  alignas (GFIFO_CACHELINE_SIZE) std::atomic<std::size_t> in_;
+  std::size_t out_cache_;
+
+  /* consumer side */
+  alignas (GFIFO_CACHELINE_SIZE) std::atomic<std::size_t> out_;
+  mutable std::size_t in_cache_;
+
+  alignas (GFIFO_CACHELINE_SIZE) alignas (T) unsigned char
+      data_[N * sizeof (T)];
+};
+
+#endif /* __GENERIC_FIFO_HPP__ */
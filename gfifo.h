@@ -7,18 +7,913 @@
  * @date 2024-08-13
  */
 
+#ifndef __GFIFO_H__
+#define __GFIFO_H__
+
 #include <string.h>
 
+/**
+ * @brief Single producer / single consumer mode
+ *
+ * Define GFIFO_SPSC before including this file to use one fifo from one
+ * producer thread and one consumer thread without any lock. The producer
+ * publishes @c in with release semantics after the element is copied in,
+ * the consumer loads it with acquire semantics before copying the element
+ * out, and the same pairing is used for @c out in the other direction.
+ *
+ * Without GFIFO_SPSC the indices are accessed with plain loads and stores.
+ */
+#if defined(GFIFO_WAIT) && !defined(GFIFO_SPSC)
+#define GFIFO_SPSC /* GFIFO_WAIT below only makes sense across threads */
+#endif
+
+#if defined(GFIFO_OVERWRITE) && !defined(GFIFO_SPSC)
+#define GFIFO_SPSC /* GFIFO_OVERWRITE's consumer races the producer's in */
+#endif
+
+#if defined(GFIFO_OVERWRITE) && !defined(GFIFO_FREE_RUNNING)
+#define GFIFO_FREE_RUNNING /* GFIFO_OVERWRITE below counts laps with it */
+#endif
+
+#if defined(GFIFO_OVERWRITE) && !defined(GFIFO_RELAXED_SLOTS)
+#define GFIFO_RELAXED_SLOTS /* its consumer may read a slot being rewritten */
+#endif
+
+#ifdef GFIFO_SPSC
+#define __gfifo_load_acquire(_idx) __atomic_load_n (&(_idx), __ATOMIC_ACQUIRE)
+#define __gfifo_store_release(_idx, _val)                                     \
+  __atomic_store_n (&(_idx), (_val), __ATOMIC_RELEASE)
+#else
+#define __gfifo_load_acquire(_idx) (_idx)
+#define __gfifo_store_release(_idx, _val) ((_idx) = (_val))
+#endif
+
+/**
+ * @brief Free running index mode
+ *
+ * By default @c in and @c out are kept masked, so one slot has to stay
+ * empty to tell a full fifo from an empty one and a fifo of @c size slots
+ * holds at most @c size - 1 elements.
+ *
+ * Define GFIFO_FREE_RUNNING to let @c in and @c out count up freely and only
+ * mask them when a slot is addressed, like the Linux kfifo. All @c size
+ * slots are then usable and the element count is a plain @c in - @c out.
+ * @c size must still be a power of two.
+ *
+ * Define GFIFO_ANY_SIZE to allow any @c size, e.g. 1000 or 3072 slots to
+ * match a hardware descriptor ring. Indices then wrap with a compare and a
+ * subtract instead of the mask; with GFIFO_FREE_RUNNING they run over
+ * [0, 2 * @c size) so that all @c size slots stay usable.
+ */
+#ifdef GFIFO_ANY_SIZE
+#if defined(GFIFO_OVERWRITE)
+#error "GFIFO_OVERWRITE needs 32 bit free running indices, not GFIFO_ANY_SIZE"
+#endif
+
+/*
+ * An index never moves by more than @c size at once, so a compare and a
+ * subtract wraps it, no division or modulo needed.
+ */
+#define __gfifo_wrap(_i, _range)                                              \
+  ({                                                                          \
+    unsigned int _tmpwi = (_i), _tmpwr = (_range);                            \
+    _tmpwi >= _tmpwr ? _tmpwi - _tmpwr : _tmpwi;                              \
+  })
+
+#define __gfifo_unwrap(_d, _range)                                            \
+  ({                                                                          \
+    unsigned int _tmpwd = (_d);                                               \
+    (int)_tmpwd < 0 ? _tmpwd + (_range) : _tmpwd;                             \
+  })
+
+#ifdef GFIFO_FREE_RUNNING
+/* in and out run over [0, 2 * size), telling full from empty */
+#define __gfifo_idx(_fifo, _i) __gfifo_wrap (_i, (_fifo)->size)
+#define __gfifo_next(_fifo, _i, _n)                                           \
+  __gfifo_wrap ((_i) + (_n), 2 * (_fifo)->size)
+#define __gfifo_used(_fifo, _in, _out)                                        \
+  __gfifo_unwrap ((_in) - (_out), 2 * (_fifo)->size)
+#define __gfifo_capacity(_fifo) ((_fifo)->size)
+#else
+#define __gfifo_idx(_fifo, _i) (_i)
+#define __gfifo_next(_fifo, _i, _n) __gfifo_wrap ((_i) + (_n), (_fifo)->size)
+#define __gfifo_used(_fifo, _in, _out)                                        \
+  __gfifo_unwrap ((_in) - (_out), (_fifo)->size)
+#define __gfifo_capacity(_fifo) ((_fifo)->size - 1)
+#endif
+#elif defined(GFIFO_FREE_RUNNING)
+#define __gfifo_idx(_fifo, _i) ((_i) & (_fifo)->mask)
+#define __gfifo_next(_fifo, _i, _n) ((_i) + (_n))
+#define __gfifo_used(_fifo, _in, _out) ((_in) - (_out))
+#define __gfifo_capacity(_fifo) ((_fifo)->size)
+#else
+#define __gfifo_idx(_fifo, _i) (_i)
+#define __gfifo_next(_fifo, _i, _n) (((_i) + (_n)) & (_fifo)->mask)
+#define __gfifo_used(_fifo, _in, _out) (((_in) - (_out)) & (_fifo)->mask)
+#define __gfifo_capacity(_fifo) ((_fifo)->mask)
+#endif
+
+/**
+ * @brief Mirrored buffer mode
+ *
+ * Define GFIFO_MIRRORED when every fifo's @c data is mapped twice back to
+ * back in virtual memory, see gfifo_mirror.h. A run of up to @c size
+ * elements starting at any slot is then contiguous, so the batched macros
+ * copy with a single memcpy and the span macros return a single span.
+ *
+ * The compiler does not know that the two halves alias, so every index
+ * publication is also a compiler barrier in this mode.
+ */
+#ifdef GFIFO_MIRRORED
+#define __gfifo_first_run(_fifo, _off, _cnt) (_cnt)
+#define __gfifo_mirror_barrier() __asm__ volatile ("" ::: "memory")
+#else
+#define __gfifo_mirror_barrier() ((void)0)
+#define __gfifo_first_run(_fifo, _off, _cnt)                                  \
+  ({                                                                          \
+    unsigned int _tmprun = (_fifo)->size - (_off);                            \
+    _tmprun < (_cnt) ? _tmprun : (_cnt);                                      \
+  })
+#endif
+
+/**
+ * @brief Position independent mode
+ *
+ * Define GFIFO_SELF_RELATIVE to store the buffer as an offset from the
+ * struct gfifo itself instead of a pointer. A fifo and its buffer placed
+ * in one shared memory segment then work at whatever address each process
+ * maps the segment, see gfifo_shm.h.
+ */
+#ifdef GFIFO_SELF_RELATIVE
+#define __gfifo_data(_fifo) ((void *)((char *)(_fifo) + (_fifo)->data_off))
+#define __gfifo_set_data(_fifo, _buf)                                         \
+  ((_fifo)->data_off = (char *)(_buf) - (char *)(_fifo))
+#else
+#define __gfifo_data(_fifo) ((_fifo)->data)
+#define __gfifo_set_data(_fifo, _buf) ((_fifo)->data = (_buf))
+#endif
+
+/* address of the slot for index _i */
+#define __gfifo_slot(_fifo, _i, _type)                                        \
+  ((_type *)__gfifo_data (_fifo) + __gfifo_idx (_fifo, _i))
+
+/**
+ * @brief Cache line separated layout
+ *
+ * Define GFIFO_CACHE_ALIGNED to place the producer owned state (@c in) and
+ * the consumer owned state (@c out) on separate cache lines, away from the
+ * read-only @c data, @c size and @c mask. Each side also keeps a private
+ * copy of the opposite index and only reloads it when the fifo looks full
+ * (producer) or empty (consumer), so the two cores only exchange cache
+ * lines when they really have to. Mostly useful together with GFIFO_SPSC.
+ *
+ * GFIFO_CACHELINE_SIZE may be overridden, e.g. 128 on machines whose
+ * adjacent line prefetcher pulls cache lines in pairs.
+ */
+#ifndef GFIFO_CACHELINE_SIZE
+#define GFIFO_CACHELINE_SIZE 64
+#endif
+
+#define __gfifo_cacheline_aligned                                             \
+  __attribute__ ((aligned (GFIFO_CACHELINE_SIZE)))
+
+/**
+ * @brief Statistics mode
+ *
+ * Define GFIFO_STATS to count, per fifo, the successful producer and
+ * consumer calls, the calls that found the fifo full or empty, the
+ * elements moved, and the highest element count seen by the producer.
+ * Each side only writes its own counters, which sit on its own cache line,
+ * so counting adds no cache line transfers. gfifo_stats_snapshot reads
+ * them from any thread for a metrics exporter.
+ *
+ * With GFIFO_CACHE_ALIGNED the producer measures the element count against
+ * its cached @c out, so @c max_used may overstate it by what the consumer
+ * removed meanwhile.
+ */
+#ifdef GFIFO_STATS
+struct gfifo_prod_stats
+{
+  unsigned long ok;
+  unsigned long full;
+  unsigned long elems;
+  unsigned int max_used;
+};
+
+struct gfifo_cons_stats
+{
+  unsigned long ok;
+  unsigned long empty;
+  unsigned long elems;
+};
+
+/**
+ * @brief Snapshot of a fifo's counters, see gfifo_stats_snapshot
+ */
+struct gfifo_stats
+{
+  unsigned long insert_ok;
+  unsigned long insert_full;
+  unsigned long insert_bytes;
+  unsigned long remove_ok;
+  unsigned long remove_empty;
+  unsigned long remove_bytes;
+  unsigned int max_used;
+  unsigned int used;
+};
+#endif
+
+/**
+ * @brief Timestamp mode
+ *
+ * Define GFIFO_TIMESTAMP to measure how long elements stay queued without
+ * changing their layout. gfifo_timestamp_init gives an initialized fifo a
+ * parallel stamp array, one entry per slot, and a struct gfifo_latency.
+ * Every publish of @c in then stamps the new slots with
+ * GFIFO_TIMESTAMP_CLOCK (), and every publish of @c out adds the time each
+ * removed element spent queued to the latency histogram. Until
+ * gfifo_timestamp_init is called nothing is measured.
+ *
+ * The histogram has 2^GFIFO_LATENCY_SUB_BITS buckets per power of two, so
+ * a reported percentile overstates the real one by at most that fraction.
+ * Only the consumer writes it, with relaxed stores, and gfifo_latency_report
+ * reads it from any thread without a lock.
+ *
+ * GFIFO_TIMESTAMP_CLOCK counts CLOCK_MONOTONIC nanoseconds by default.
+ * Define GFIFO_TIMESTAMP_TSC to count TSC (x86) or virtual counter (ARM64)
+ * ticks instead, or GFIFO_TIMESTAMP_CLOCK itself to any other clock that
+ * returns an unsigned long long.
+ */
+#ifdef GFIFO_TIMESTAMP
+#ifdef GFIFO_OVERWRITE
+#error "overwritten slots lose their stamps, build without GFIFO_OVERWRITE"
+#endif
+
+#ifndef GFIFO_LATENCY_SUB_BITS
+#define GFIFO_LATENCY_SUB_BITS 3
+#endif
+
+#define GFIFO_LATENCY_BUCKETS                                                 \
+  ((64 - GFIFO_LATENCY_SUB_BITS + 1) << GFIFO_LATENCY_SUB_BITS)
+
+/**
+ * @brief Log bucketed histogram of queueing times
+ */
+struct gfifo_latency
+{
+  unsigned long count[GFIFO_LATENCY_BUCKETS];
+  unsigned long long max;
+};
+
+/**
+ * @brief Percentiles read from a struct gfifo_latency, in clock units
+ */
+struct gfifo_latency_report
+{
+  unsigned long count;
+  unsigned long long p50;
+  unsigned long long p99;
+  unsigned long long p999;
+  unsigned long long max;
+};
+
+#ifndef GFIFO_TIMESTAMP_CLOCK
+#if defined(GFIFO_TIMESTAMP_TSC)                                              \
+    && (defined(__x86_64__) || defined(__i386__))
+#define GFIFO_TIMESTAMP_CLOCK() ((unsigned long long)__builtin_ia32_rdtsc ())
+#elif defined(GFIFO_TIMESTAMP_TSC) && defined(__aarch64__)
+static inline unsigned long long
+__gfifo_cntvct (void)
+{
+  unsigned long long ticks;
+
+  __asm__ volatile ("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+}
+#define GFIFO_TIMESTAMP_CLOCK() __gfifo_cntvct ()
+#else
+#include <time.h>
+
+static inline unsigned long long
+__gfifo_monotonic_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#define GFIFO_TIMESTAMP_CLOCK() __gfifo_monotonic_ns ()
+#endif
+#endif
+#endif
+
+#ifdef GFIFO_CACHE_ALIGNED
+
 /**
  * @brief Generic Circular FIFO
  */
 struct gfifo
 {
+#ifdef GFIFO_SELF_RELATIVE
+  long data_off;
+#else
   void *data;
+#endif
+  unsigned int size;
+  unsigned int mask;
+#ifdef GFIFO_TIMESTAMP
+  unsigned long long *stamps;
+  struct gfifo_latency *latency;
+#endif
+
+  /* producer side */
+  unsigned int in __gfifo_cacheline_aligned;
+  unsigned int out_cache;
+#ifdef GFIFO_WAIT
+  unsigned int prod_spin;
+#endif
+#ifdef GFIFO_OVERWRITE
+  unsigned int dropped;
+#endif
+#ifdef GFIFO_STATS
+  struct gfifo_prod_stats prod_stats;
+#endif
+
+  /* consumer side */
+  unsigned int out __gfifo_cacheline_aligned;
+  unsigned int in_cache;
+#ifdef GFIFO_OVERWRITE
+  unsigned int out_seen;
+#endif
+#ifdef GFIFO_STATS
+  struct gfifo_cons_stats cons_stats;
+#endif
+#ifdef GFIFO_WAIT
+  unsigned int cons_spin;
+
+  /* waiter flags, read on every publish but rarely written */
+  unsigned int prod_waiting __gfifo_cacheline_aligned;
+  unsigned int cons_waiting;
+#endif
+} __gfifo_cacheline_aligned;
+
+/* free slots seen by the producer, reload @c out only if fewer than _n */
+#define __gfifo_prod_space(_fifo, _n)                                         \
+  ({                                                                          \
+    unsigned int _tmpsp                                                       \
+        = __gfifo_capacity (_fifo)                                            \
+          - __gfifo_used (_fifo, (_fifo)->in, (_fifo)->out_cache);            \
+    if (_tmpsp < (_n))                                                        \
+      {                                                                       \
+        (_fifo)->out_cache = __gfifo_load_acquire ((_fifo)->out);             \
+        _tmpsp = __gfifo_capacity (_fifo)                                     \
+                 - __gfifo_used (_fifo, (_fifo)->in, (_fifo)->out_cache);     \
+      }                                                                       \
+    _tmpsp;                                                                   \
+  })
+
+/* used slots seen by the consumer, reload @c in only if fewer than _n */
+#define __gfifo_cons_count(_fifo, _n)                                         \
+  ({                                                                          \
+    unsigned int _tmpcnt                                                      \
+        = __gfifo_used (_fifo, (_fifo)->in_cache, (_fifo)->out);              \
+    if (_tmpcnt < (_n))                                                       \
+      {                                                                       \
+        (_fifo)->in_cache = __gfifo_load_acquire ((_fifo)->in);               \
+        _tmpcnt = __gfifo_used (_fifo, (_fifo)->in_cache, (_fifo)->out);      \
+      }                                                                       \
+    _tmpcnt;                                                                  \
+  })
+
+#define __gfifo_reset_cache(_fifo)                                            \
+  ({                                                                          \
+    (_fifo)->out_cache = 0;                                                   \
+    (_fifo)->in_cache = 0;                                                    \
+  })
+
+#define __gfifo_set_out_cache(_fifo, _val) ((_fifo)->out_cache = (_val))
+#else
+/**
+ * @brief Generic Circular FIFO
+ */
+struct gfifo
+{
+#ifdef GFIFO_SELF_RELATIVE
+  long data_off;
+#else
+  void *data;
+#endif
   unsigned int in;
   unsigned int out;
   unsigned int size;
   unsigned int mask;
+#ifdef GFIFO_TIMESTAMP
+  unsigned long long *stamps;
+  struct gfifo_latency *latency;
+#endif
+#ifdef GFIFO_OVERWRITE
+  unsigned int dropped;
+  unsigned int out_seen;
+#endif
+#ifdef GFIFO_WAIT
+  unsigned int prod_spin;
+  unsigned int cons_spin;
+  unsigned int prod_waiting;
+  unsigned int cons_waiting;
+#endif
+#ifdef GFIFO_STATS
+  struct gfifo_prod_stats prod_stats __gfifo_cacheline_aligned;
+  struct gfifo_cons_stats cons_stats __gfifo_cacheline_aligned;
+#endif
+};
+
+#define __gfifo_prod_space(_fifo, _n)                                         \
+  (__gfifo_capacity (_fifo)                                                   \
+   - __gfifo_used (_fifo, (_fifo)->in, __gfifo_load_acquire ((_fifo)->out)))
+
+#define __gfifo_cons_count(_fifo, _n)                                         \
+  __gfifo_used (_fifo, __gfifo_load_acquire ((_fifo)->in), (_fifo)->out)
+
+#define __gfifo_reset_cache(_fifo) ((void)0)
+#define __gfifo_set_out_cache(_fifo, _val) ((void)0)
+#endif
+
+/**
+ * @brief Blocking wait mode
+ *
+ * Define GFIFO_WAIT to get gfifo_insert_wait and gfifo_remove_wait, which
+ * block until the operation succeeds or a timeout expires. A waiter first
+ * spins for an adaptive number of rounds (grown when spinning paid off,
+ * shrunk when it had to sleep anyway), then raises its waiter flag and
+ * parks on a futex on the opposite index. The other side only enters the
+ * kernel when it sees that flag after publishing its index, so the non
+ * blocking macros stay free of syscalls; they do pay one full fence per
+ * publish in this mode.
+ *
+ * On systems without futex the parked waiter polls with a short sleep.
+ */
+#ifdef GFIFO_WAIT
+#include <time.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifndef GFIFO_WAIT_SPIN_MIN
+#define GFIFO_WAIT_SPIN_MIN 16
+#endif
+
+#ifndef GFIFO_WAIT_SPIN_MAX
+#define GFIFO_WAIT_SPIN_MAX 4096
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define __gfifo_cpu_relax() __builtin_ia32_pause ()
+#elif defined(__aarch64__) || defined(__arm__)
+#define __gfifo_cpu_relax() __asm__ volatile ("yield" ::: "memory")
+#else
+#define __gfifo_cpu_relax() __asm__ volatile ("" ::: "memory")
+#endif
+
+/* absolute CLOCK_MONOTONIC deadline, negative _ms waits forever */
+static inline void
+__gfifo_deadline (struct timespec *_dl, int _ms)
+{
+  if (_ms < 0)
+    {
+      _dl->tv_sec = -1;
+      return;
+    }
+  clock_gettime (CLOCK_MONOTONIC, _dl);
+  _dl->tv_sec += _ms / 1000;
+  _dl->tv_nsec += (_ms % 1000) * 1000000L;
+  if (_dl->tv_nsec >= 1000000000L)
+    {
+      _dl->tv_sec++;
+      _dl->tv_nsec -= 1000000000L;
+    }
+}
+
+static inline int
+__gfifo_expired (const struct timespec *_dl)
+{
+  struct timespec _now;
+
+  if (_dl->tv_sec < 0)
+    return 0;
+  clock_gettime (CLOCK_MONOTONIC, &_now);
+  return _now.tv_sec > _dl->tv_sec
+         || (_now.tv_sec == _dl->tv_sec && _now.tv_nsec >= _dl->tv_nsec);
+}
+
+/* a self relative fifo may be shared between processes */
+#ifdef GFIFO_SELF_RELATIVE
+#define __GFIFO_FUTEX_WAIT FUTEX_WAIT_BITSET
+#define __GFIFO_FUTEX_WAKE FUTEX_WAKE
+#else
+#define __GFIFO_FUTEX_WAIT FUTEX_WAIT_BITSET_PRIVATE
+#define __GFIFO_FUTEX_WAKE FUTEX_WAKE_PRIVATE
+#endif
+
+/* sleep while *_idx == _seen, until woken or _dl passes */
+static inline void
+__gfifo_park (unsigned int *_idx, unsigned int _seen,
+              const struct timespec *_dl)
+{
+#ifdef __linux__
+  syscall (SYS_futex, _idx, __GFIFO_FUTEX_WAIT, _seen,
+           _dl->tv_sec < 0 ? NULL : _dl, NULL, FUTEX_BITSET_MATCH_ANY);
+#else
+  struct timespec _ts = { 0, 50000 };
+
+  if (__atomic_load_n (_idx, __ATOMIC_ACQUIRE) == _seen)
+    nanosleep (&_ts, NULL);
+#endif
+}
+
+static inline void
+__gfifo_unpark (unsigned int *_idx)
+{
+#ifdef __linux__
+  syscall (SYS_futex, _idx, __GFIFO_FUTEX_WAKE, 1, NULL, NULL, 0);
+#else
+  (void)_idx;
+#endif
+}
+
+/* spin one more round if the budget allows */
+static inline int
+__gfifo_spin (unsigned int _budget, unsigned int *_round)
+{
+  if (*_round >= _budget)
+    return 0;
+  (*_round)++;
+  __gfifo_cpu_relax ();
+  return 1;
+}
+
+/* grow the spin budget if spinning paid off, shrink it if we parked */
+static inline void
+__gfifo_spin_adapt (unsigned int *_budget, unsigned int _round,
+                    unsigned int _parked)
+{
+  if (_parked)
+    {
+      if (*_budget > GFIFO_WAIT_SPIN_MIN)
+        *_budget /= 2;
+    }
+  else if (_round && *_budget < GFIFO_WAIT_SPIN_MAX)
+    *_budget *= 2;
+}
+
+#define __gfifo_wake(_idx, _flag)                                             \
+  ({                                                                          \
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);                                 \
+    if (__builtin_expect (__atomic_load_n (&(_flag), __ATOMIC_RELAXED), 0))   \
+      __gfifo_unpark (&(_idx));                                               \
+  })
+
+#define __gfifo_reset_wait(_fifo)                                             \
+  ({                                                                          \
+    (_fifo)->prod_spin = GFIFO_WAIT_SPIN_MIN;                                 \
+    (_fifo)->cons_spin = GFIFO_WAIT_SPIN_MIN;                                 \
+    (_fifo)->prod_waiting = 0;                                                \
+    (_fifo)->cons_waiting = 0;                                                \
+  })
+#else
+#define __gfifo_wake(_idx, _flag) ((void)0)
+#define __gfifo_reset_wait(_fifo) ((void)0)
+#endif
+
+#ifdef GFIFO_STATS
+#ifdef GFIFO_CACHE_ALIGNED
+#define __gfifo_stat_out_view(_fifo) ((_fifo)->out_cache)
+#else
+#define __gfifo_stat_out_view(_fifo)                                          \
+  __atomic_load_n (&(_fifo)->out, __ATOMIC_RELAXED)
+#endif
+
+#define __gfifo_stat_add(_ctr, _n)                                            \
+  __atomic_store_n (&(_ctr), (_ctr) + (_n), __ATOMIC_RELAXED)
+
+/* producer moved _n elements in, @c in not yet published */
+#define __gfifo_stat_produce(_fifo, _n)                                       \
+  ({                                                                          \
+    unsigned int _tmpused                                                     \
+        = __gfifo_used (_fifo, (_fifo)->in, __gfifo_stat_out_view (_fifo))    \
+          + (_n);                                                             \
+    __gfifo_stat_add ((_fifo)->prod_stats.ok, 1);                             \
+    __gfifo_stat_add ((_fifo)->prod_stats.elems, (_n));                       \
+    if (_tmpused > (_fifo)->prod_stats.max_used)                              \
+      __atomic_store_n (&(_fifo)->prod_stats.max_used, _tmpused,              \
+                        __ATOMIC_RELAXED);                                    \
+  })
+
+#define __gfifo_stat_consume(_fifo, _n)                                       \
+  ({                                                                          \
+    __gfifo_stat_add ((_fifo)->cons_stats.ok, 1);                             \
+    __gfifo_stat_add ((_fifo)->cons_stats.elems, (_n));                       \
+  })
+
+/* pass _ok through, counting a full / empty fifo when it is 0 */
+#define __gfifo_stat_room(_fifo, _ok)                                         \
+  ({                                                                          \
+    typeof ((_ok) + 0) _tmpok = (_ok);                                        \
+    if (!_tmpok)                                                              \
+      __gfifo_stat_add ((_fifo)->prod_stats.full, 1);                         \
+    _tmpok;                                                                   \
+  })
+
+#define __gfifo_stat_avail(_fifo, _ok)                                        \
+  ({                                                                          \
+    typeof ((_ok) + 0) _tmpok = (_ok);                                        \
+    if (!_tmpok)                                                              \
+      __gfifo_stat_add ((_fifo)->cons_stats.empty, 1);                        \
+    _tmpok;                                                                   \
+  })
+
+#define __gfifo_reset_stats(_fifo)                                            \
+  ({                                                                          \
+    memset (&(_fifo)->prod_stats, 0, sizeof ((_fifo)->prod_stats));           \
+    memset (&(_fifo)->cons_stats, 0, sizeof ((_fifo)->cons_stats));           \
+  })
+#else
+#define __gfifo_stat_produce(_fifo, _n) ((void)0)
+#define __gfifo_stat_consume(_fifo, _n) ((void)0)
+#define __gfifo_stat_room(_fifo, _ok) (_ok)
+#define __gfifo_stat_avail(_fifo, _ok) (_ok)
+#define __gfifo_reset_stats(_fifo) ((void)0)
+#endif
+
+#ifdef GFIFO_TIMESTAMP
+static inline unsigned int
+__gfifo_latency_bucket (unsigned long long t)
+{
+  unsigned int msb;
+
+  if (t < (1u << GFIFO_LATENCY_SUB_BITS))
+    return (unsigned int)t;
+  msb = 63 - __builtin_clzll (t);
+  return ((msb - GFIFO_LATENCY_SUB_BITS + 1) << GFIFO_LATENCY_SUB_BITS)
+         + ((t >> (msb - GFIFO_LATENCY_SUB_BITS))
+            & ((1u << GFIFO_LATENCY_SUB_BITS) - 1));
+}
+
+/* largest time that falls into bucket b */
+static inline unsigned long long
+__gfifo_latency_upper (unsigned int b)
+{
+  unsigned int e = b >> GFIFO_LATENCY_SUB_BITS;
+  unsigned long long m = b & ((1u << GFIFO_LATENCY_SUB_BITS) - 1);
+
+  if (!e)
+    return m;
+  return (((1ULL << GFIFO_LATENCY_SUB_BITS) + m + 1) << (e - 1)) - 1;
+}
+
+/* consumer only, a clock that went backwards counts as 0 */
+static inline void
+__gfifo_latency_add (struct gfifo_latency *lat, unsigned long long t)
+{
+  unsigned int b;
+
+  if ((long long)t < 0)
+    t = 0;
+  b = __gfifo_latency_bucket (t);
+  __atomic_store_n (&lat->count[b], lat->count[b] + 1, __ATOMIC_RELAXED);
+  if (t > lat->max)
+    __atomic_store_n (&lat->max, t, __ATOMIC_RELAXED);
+}
+
+/* producer is about to publish slots [in, _val) */
+#define __gfifo_stamp_in(_fifo, _val)                                         \
+  ({                                                                          \
+    if ((_fifo)->stamps)                                                      \
+      {                                                                       \
+        unsigned long long _tmpts = GFIFO_TIMESTAMP_CLOCK ();                 \
+        unsigned int _tmpsi = (_fifo)->in, _tmpse = (_val);                   \
+        for (; _tmpsi != _tmpse; _tmpsi = __gfifo_next (_fifo, _tmpsi, 1))    \
+          (_fifo)->stamps[__gfifo_idx (_fifo, _tmpsi)] = _tmpts;              \
+      }                                                                       \
+  })
+
+/* consumer is about to release slots [out, _val) */
+#define __gfifo_stamp_out(_fifo, _val)                                        \
+  ({                                                                          \
+    if ((_fifo)->stamps)                                                      \
+      {                                                                       \
+        unsigned long long _tmpts = GFIFO_TIMESTAMP_CLOCK ();                 \
+        unsigned int _tmpsi = (_fifo)->out, _tmpse = (_val);                  \
+        for (; _tmpsi != _tmpse; _tmpsi = __gfifo_next (_fifo, _tmpsi, 1))    \
+          __gfifo_latency_add (                                               \
+              (_fifo)->latency,                                               \
+              _tmpts - (_fifo)->stamps[__gfifo_idx (_fifo, _tmpsi)]);         \
+      }                                                                       \
+  })
+
+#define __gfifo_reset_timestamp(_fifo)                                        \
+  ({                                                                          \
+    (_fifo)->stamps = NULL;                                                   \
+    (_fifo)->latency = NULL;                                                  \
+  })
+
+/**
+ * @brief start measuring how long elements stay in a fifo
+ *
+ * Call after gfifo_init, before the fifo is used.
+ *
+ * @param[inout] _fifo: fifo's address
+ * @param[in] _stamps: stamp array, @c size unsigned long long
+ * @param[out] _lat: histogram, reset here
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, @c _stamps or @c _lat is NULL, nothing is measured
+ */
+#define gfifo_timestamp_init(_fifo, _stamps, _lat)                            \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    unsigned long long *_tmpst = _stamps;                                     \
+    struct gfifo_latency *_tmplat = _lat;                                     \
+    unsigned int _ret = _tmpst && _tmplat;                                    \
+    /* both hooks test stamps, so it is only set along with latency */        \
+    _tmp->latency = _ret ? _tmplat : NULL;                                    \
+    _tmp->stamps = _ret ? _tmpst : NULL;                                      \
+    if (_ret)                                                                 \
+      memset (_tmplat, 0, sizeof (*_tmplat));                                 \
+    _ret;                                                                     \
+  })
+
+/**
+ * @brief read percentiles from a latency histogram
+ *
+ * May be called from any thread. Each percentile is the upper bound of
+ * the bucket it falls into.
+ *
+ * @param[in] lat: histogram
+ * @param[out] rep: element count, p50, p99, p999 and maximum
+ */
+static inline void
+gfifo_latency_report (const struct gfifo_latency *lat,
+                      struct gfifo_latency_report *rep)
+{
+  static const unsigned int permille[3] = { 500, 990, 999 };
+  unsigned long long *pct[3] = { &rep->p50, &rep->p99, &rep->p999 };
+  unsigned long count[GFIFO_LATENCY_BUCKETS], total = 0, seen = 0;
+  unsigned int b, p = 0;
+
+  for (b = 0; b < GFIFO_LATENCY_BUCKETS; b++)
+    {
+      count[b] = __atomic_load_n (&lat->count[b], __ATOMIC_RELAXED);
+      total += count[b];
+    }
+  rep->count = total;
+  rep->p50 = rep->p99 = rep->p999 = 0;
+  rep->max = __atomic_load_n (&lat->max, __ATOMIC_RELAXED);
+  for (b = 0; b < GFIFO_LATENCY_BUCKETS && p < 3 && total; b++)
+    {
+      seen += count[b];
+      /* first bucket holding the ceil (total * q)th smallest time */
+      while (p < 3 && seen * 1000 >= total * permille[p])
+        *pct[p++] = __gfifo_latency_upper (b);
+    }
+}
+#else
+#define __gfifo_stamp_in(_fifo, _val) ((void)0)
+#define __gfifo_stamp_out(_fifo, _val) ((void)0)
+#define __gfifo_reset_timestamp(_fifo) ((void)0)
+#endif
+
+/* make the producer's / consumer's index update visible to the other side */
+#define __gfifo_publish_in(_fifo, _val)                                       \
+  ({                                                                          \
+    __gfifo_stat_produce (_fifo, __gfifo_used (_fifo, (_val), (_fifo)->in));  \
+    __gfifo_stamp_in (_fifo, _val);                                           \
+    __gfifo_advance_in (_fifo, _val);                                         \
+  })
+
+#define __gfifo_publish_out(_fifo, _val)                                      \
+  ({                                                                          \
+    __gfifo_stat_consume (_fifo, __gfifo_used (_fifo, (_val), (_fifo)->out)); \
+    __gfifo_stamp_out (_fifo, _val);                                          \
+    __gfifo_advance_out (_fifo, _val);                                        \
+  })
+
+/* same without counting or stamping, e.g. for padding that holds no data */
+#define __gfifo_advance_in(_fifo, _val)                                       \
+  ({                                                                          \
+    __gfifo_mirror_barrier ();                                                \
+    __gfifo_store_release ((_fifo)->in, (_val));                              \
+    __gfifo_wake ((_fifo)->in, (_fifo)->cons_waiting);                        \
+  })
+
+#define __gfifo_advance_out(_fifo, _val)                                      \
+  ({                                                                          \
+    __gfifo_mirror_barrier ();                                                \
+    __gfifo_store_release ((_fifo)->out, (_val));                             \
+    __gfifo_wake ((_fifo)->out, (_fifo)->prod_waiting);                       \
+  })
+
+/**
+ * @brief Relaxed slot mode
+ *
+ * Define GFIFO_RELAXED_SLOTS when a consumer may copy a slot while the
+ * producer already rewrites it and throws that copy away afterwards, as
+ * the claiming consumers of gfifo_shard.h do. The element copies of the
+ * insert, remove and peek macros then use relaxed atomic accesses of the
+ * widest word that the addresses and size allow instead of memcpy, which
+ * keeps such a race well defined. gfifo_reserve, gfifo_acquire and the
+ * span macros hand out slots for plain accesses and are not covered.
+ * GFIFO_OVERWRITE implies this mode.
+ */
+#ifdef GFIFO_RELAXED_SLOTS
+/* copy _n bytes in _word sized relaxed atomic accesses */
+#define __gfifo_relaxed_words(_dst, _src, _n, _word)                          \
+  ({                                                                          \
+    size_t _tmpri;                                                            \
+    for (_tmpri = 0; _tmpri < (_n); _tmpri += sizeof (_word))                 \
+      __atomic_store_n ((_word *)((char *)(_dst) + _tmpri),                   \
+                        __atomic_load_n ((const _word *)((const char *)(_src) \
+                                                         + _tmpri),           \
+                                         __ATOMIC_RELAXED),                   \
+                        __ATOMIC_RELAXED);                                    \
+  })
+
+/* copy an element one side reads while the other may write it */
+static inline void
+__gfifo_relaxed_copy (void *_dst, const void *_src, size_t _n)
+{
+  unsigned long _align = (unsigned long)_dst | (unsigned long)_src | _n;
+
+  if (_align % sizeof (unsigned long) == 0)
+    __gfifo_relaxed_words (_dst, _src, _n, unsigned long);
+  else if (_align % sizeof (unsigned int) == 0)
+    __gfifo_relaxed_words (_dst, _src, _n, unsigned int);
+  else
+    __gfifo_relaxed_words (_dst, _src, _n, unsigned char);
+}
+
+#define __gfifo_slot_copy(_dst, _src, _n) __gfifo_relaxed_copy (_dst, _src, _n)
+#else
+#define __gfifo_slot_copy(_dst, _src, _n) memcpy (_dst, _src, _n)
+#endif
+
+/**
+ * @brief Overwrite oldest mode
+ *
+ * Define GFIFO_OVERWRITE for rings where the newest data matters more than
+ * the oldest, e.g. traces and metrics. gfifo_insert then always succeeds:
+ * on a full fifo it advances @c out past the oldest element with a single
+ * compare-and-swap and counts it in gfifo_dropped. gfifo_remove claims its
+ * element with a compare-and-swap as well, so it never returns one the
+ * producer overwrote while it was being copied, and gfifo_remove_lossy
+ * also reports how many elements the consumer lost since its previous
+ * remove. This mode implies GFIFO_FREE_RUNNING and GFIFO_SPSC.
+ *
+ * Only gfifo_insert overwrites; the batched and in place producer macros
+ * still fail on a full fifo. The producer may be rewriting the slot the
+ * consumer copies, so both sides copy elements with relaxed atomic loads
+ * and stores and a torn copy is thrown away when the compare-and-swap
+ * fails. The other consumer macros read slots without claiming them and
+ * do not compile in this mode: use gfifo_remove and gfifo_remove_lossy.
+ */
+#ifdef GFIFO_OVERWRITE
+/* push @c out past the oldest element if the fifo is full */
+#define __gfifo_make_room(_fifo)                                              \
+  ({                                                                          \
+    unsigned int _tmpold = __atomic_load_n (&(_fifo)->out, __ATOMIC_ACQUIRE); \
+    while ((_fifo)->in - _tmpold == (_fifo)->size)                            \
+      if (__atomic_compare_exchange_n (&(_fifo)->out, &_tmpold, _tmpold + 1,  \
+                                       0, __ATOMIC_ACQUIRE,                   \
+                                       __ATOMIC_ACQUIRE))                     \
+        {                                                                     \
+          __atomic_store_n (&(_fifo)->dropped, (_fifo)->dropped + 1,          \
+                            __ATOMIC_RELAXED);                                \
+          _tmpold++;                                                          \
+          break;                                                              \
+        }                                                                     \
+    __gfifo_set_out_cache (_fifo, _tmpold);                                   \
+  })
+
+#define __gfifo_reset_overwrite(_fifo)                                        \
+  ({                                                                          \
+    (_fifo)->dropped = 0;                                                     \
+    (_fifo)->out_seen = 0;                                                    \
+  })
+#else
+#define __gfifo_reset_overwrite(_fifo) ((void)0)
+#endif
+
+/**
+ * @brief Contiguous region of a fifo's buffer
+ *
+ * @c len counts elements, scale it by the element size to fill an iovec.
+ */
+struct gfifo_span
+{
+  void *base;
+  unsigned int len;
 };
 
 /**
@@ -26,16 +921,21 @@ struct gfifo
  *
  * @param[inout] _fifo: fifo's address
  * @param[in] _buf: fifo's buffer
- * @param[in] _size: fifo's size
+ * @param[in] _size: fifo's size, a power of two unless GFIFO_ANY_SIZE
  */
 #define gfifo_init(_fifo, _buf, _size)                                        \
   ({                                                                          \
     typeof (_fifo + 1) _tmp = _fifo;                                          \
-    _tmp->data = _buf;                                                        \
+    __gfifo_set_data (_tmp, _buf);                                            \
     _tmp->in = 0;                                                             \
     _tmp->out = 0;                                                            \
     _tmp->size = _size;                                                       \
     _tmp->mask = _size - 1;                                                   \
+    __gfifo_reset_cache (_tmp);                                               \
+    __gfifo_reset_wait (_tmp);                                                \
+    __gfifo_reset_overwrite (_tmp);                                           \
+    __gfifo_reset_stats (_tmp);                                               \
+    __gfifo_reset_timestamp (_tmp);                                           \
   })
 
 /**
@@ -46,7 +946,7 @@ struct gfifo
 #define gfifo_empty(_fifo)                                                    \
   (unsigned int)({                                                            \
     typeof (_fifo + 1) _tmp = _fifo;                                          \
-    _tmp->in == _tmp->out;                                                    \
+    __gfifo_load_acquire (_tmp->in) == __gfifo_load_acquire (_tmp->out);      \
   })
 
 /**
@@ -57,7 +957,9 @@ struct gfifo
 #define gfifo_full(_fifo)                                                     \
   (unsigned int)({                                                            \
     typeof (_fifo + 1) _tmp = _fifo;                                          \
-    ((_tmp->in + 1) & _tmp->mask) == _tmp->out;                               \
+    __gfifo_used (_tmp, __gfifo_load_acquire (_tmp->in),                      \
+                  __gfifo_load_acquire (_tmp->out))                           \
+        == __gfifo_capacity (_tmp);                                           \
   })
 
 /**
@@ -68,7 +970,8 @@ struct gfifo
 #define gfifo_vaild_count(_fifo)                                              \
   (unsigned int)({                                                            \
     typeof (_fifo + 1) _tmp = _fifo;                                          \
-    (_tmp->in - _tmp->out) & _tmp->mask;                                      \
+    __gfifo_used (_tmp, __gfifo_load_acquire (_tmp->in),                      \
+                  __gfifo_load_acquire (_tmp->out));                          \
   })
 
 /**
@@ -80,21 +983,38 @@ struct gfifo
  *
  * @retval:
  *    \li 1: success
- *    \li 0: failed
+ *    \li 0: failed, never with GFIFO_OVERWRITE
  */
+#ifdef GFIFO_OVERWRITE
+#define gfifo_insert(_fifo, _value, _type)                                    \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_value + 1) _tmpv = _value;                                       \
+    unsigned int _tmpin = _tmp->in;                                           \
+    if (!__gfifo_prod_space (_tmp, 1))                                        \
+      __gfifo_make_room (_tmp);                                               \
+    __gfifo_slot_copy (__gfifo_slot (_tmp, _tmpin, _type), _tmpv,             \
+                       sizeof (_type));                                       \
+    __gfifo_publish_in (_tmp, __gfifo_next (_tmp, _tmpin, 1));                \
+    1U;                                                                       \
+  })
+#else
 #define gfifo_insert(_fifo, _value, _type)                                    \
   (unsigned int)({                                                            \
     unsigned int _ret;                                                        \
     typeof (_fifo + 1) _tmp = _fifo;                                          \
     typeof (_value + 1) _tmpv = _value;                                       \
-    _ret = !(((_tmp->in + 1) & _tmp->mask) == _tmp->out);                     \
+    unsigned int _tmpin = _tmp->in;                                           \
+    _ret = __gfifo_stat_room (_tmp, __gfifo_prod_space (_tmp, 1) != 0);       \
     if (_ret)                                                                 \
       {                                                                       \
-        memcpy ((_type *)_tmp->data + _tmp->in, _tmpv, sizeof (_type));       \
-        _tmp->in = (_tmp->in + 1) & _tmp->mask;                               \
+        __gfifo_slot_copy (__gfifo_slot (_tmp, _tmpin, _type), _tmpv,         \
+                           sizeof (_type));                                   \
+        __gfifo_publish_in (_tmp, __gfifo_next (_tmp, _tmpin, 1));            \
       }                                                                       \
     _ret;                                                                     \
   })
+#endif
 
 /**
  * @brief remove an element from fifo
@@ -107,19 +1027,79 @@ struct gfifo
  *    \li 1: success
  *    \li 0: failed
  */
+#ifdef GFIFO_OVERWRITE
 #define gfifo_remove(_fifo, _value, _type)                                    \
+  (unsigned int)({                                                            \
+    unsigned int _tmplost;                                                    \
+    gfifo_remove_lossy (_fifo, _value, _type, &_tmplost);                     \
+  })
+
+/**
+ * @brief remove an element from a fifo the producer may overwrite
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _value: element's address
+ * @param [in] _type: element's type
+ * @param [out] _lost: number of elements overwritten, and so never seen by
+ *                     the consumer, since the previous remove
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed
+ */
+#define gfifo_remove_lossy(_fifo, _value, _type, _lost)                       \
   (unsigned int)({                                                            \
     unsigned int _ret;                                                        \
     typeof (_fifo + 1) _tmp = _fifo;                                          \
     typeof (_value + 1) _tmpv = _value;                                       \
-    _ret = !(_tmp->in == _tmp->out);                                          \
+    unsigned int _tmpout = __atomic_load_n (&_tmp->out, __ATOMIC_ACQUIRE);    \
+    for (;;)                                                                  \
+      {                                                                       \
+        _ret = (__atomic_load_n (&_tmp->in, __ATOMIC_ACQUIRE) != _tmpout);    \
+        if (!_ret)                                                            \
+          break;                                                              \
+        __gfifo_slot_copy (_tmpv, __gfifo_slot (_tmp, _tmpout, _type),        \
+                           sizeof (_type));                                   \
+        if (__atomic_compare_exchange_n (&_tmp->out, &_tmpout, _tmpout + 1,   \
+                                         0, __ATOMIC_ACQ_REL,                 \
+                                         __ATOMIC_ACQUIRE))                   \
+          break;                                                              \
+        /* lapped while copying, _tmpout is the new oldest element */         \
+      }                                                                       \
+    *(_lost) = _ret ? _tmpout - _tmp->out_seen : 0;                           \
+    if (__gfifo_stat_avail (_tmp, _ret))                                      \
+      {                                                                       \
+        __gfifo_stat_consume (_tmp, 1);                                       \
+        _tmp->out_seen = _tmpout + 1;                                         \
+        __gfifo_wake (_tmp->out, _tmp->prod_waiting);                         \
+      }                                                                       \
+    _ret;                                                                     \
+  })
+
+/**
+ * @brief return number of element overwritten since gfifo_init
+ *
+ * @param [in] _fifo: fifo's address
+ */
+#define gfifo_dropped(_fifo)                                                  \
+  __atomic_load_n (&(_fifo)->dropped, __ATOMIC_RELAXED)
+#else
+#define gfifo_remove(_fifo, _value, _type)                                    \
+  (unsigned int)({                                                            \
+    unsigned int _ret;                                                        \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_value + 1) _tmpv = _value;                                       \
+    unsigned int _tmpout = _tmp->out;                                         \
+    _ret = __gfifo_stat_avail (_tmp, __gfifo_cons_count (_tmp, 1) != 0);      \
     if (_ret)                                                                 \
       {                                                                       \
-        memcpy (_tmpv, (_type *)_tmp->data + _tmp->out, sizeof (_type));      \
-        _tmp->out = (_tmp->out + 1) & _tmp->mask;                             \
+        __gfifo_slot_copy (_tmpv, __gfifo_slot (_tmp, _tmpout, _type),        \
+                           sizeof (_type));                                   \
+        __gfifo_publish_out (_tmp, __gfifo_next (_tmp, _tmpout, 1));          \
       }                                                                       \
     _ret;                                                                     \
   })
+#endif
 
 /**
  * @brief get an element data without removing
@@ -137,10 +1117,44 @@ struct gfifo
     unsigned int _ret;                                                        \
     typeof (_fifo + 1) _tmp = _fifo;                                          \
     typeof (_value + 1) _tmpv = _value;                                       \
-    _ret = !(_tmp->in == _tmp->out);                                          \
+    unsigned int _tmpout = _tmp->out;                                         \
+    _ret = (__gfifo_cons_count (_tmp, 1) != 0);                               \
     if (_ret)                                                                 \
       {                                                                       \
-        memcpy (_tmpv, (_type *)_tmp->data + _tmp->out, sizoef (_type));      \
+        __gfifo_slot_copy (_tmpv, __gfifo_slot (_tmp, _tmpout, _type),        \
+                           sizeof (_type));                                   \
+      }                                                                       \
+    _ret;                                                                     \
+  })
+
+/**
+ * @brief get the data of the element at a position without removing
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _value: element's address
+ * @param [in] _index: position counted from the oldest element, 0 is the
+ *                     element gfifo_peek returns
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, fewer than @c _index + 1 elements in fifo
+ */
+#define gfifo_peek_at(_fifo, _value, _index, _type)                           \
+  (unsigned int)({                                                            \
+    unsigned int _ret;                                                        \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_value + 1) _tmpv = _value;                                       \
+    unsigned int _tmpidx = _index;                                            \
+    unsigned int _tmpout = _tmp->out;                                         \
+    _ret = (__gfifo_cons_count (_tmp, _tmpidx + 1) > _tmpidx);                \
+    if (_ret)                                                                 \
+      {                                                                       \
+        __gfifo_slot_copy (                                                   \
+            _tmpv,                                                            \
+            __gfifo_slot (_tmp, __gfifo_next (_tmp, _tmpout, _tmpidx),        \
+                          _type),                                             \
+            sizeof (_type));                                                  \
       }                                                                       \
     _ret;                                                                     \
   })
@@ -160,19 +1174,183 @@ struct gfifo
   (unsigned int)({                                                            \
     unsigned int _ret;                                                        \
     typeof (_fifo + 1) _tmp = _fifo;                                          \
-    _ret = !(_tmp->in == _tmp->out);                                          \
+    unsigned int _tmpout = _tmp->out;                                         \
+    _ret = (__gfifo_cons_count (_tmp, 1) != 0);                               \
     if (_ret)                                                                 \
       {                                                                       \
-        _tmp->out = (_tmp->out + 1) & _tmp->mask;                             \
+        __gfifo_publish_out (_tmp, __gfifo_next (_tmp, _tmpout, 1));          \
       }                                                                       \
     _ret;                                                                     \
   })
 
+/**
+ * @brief get the address of the next free slot for in place producing
+ *
+ * The element is built directly in the fifo's buffer and becomes visible
+ * to the consumer only after gfifo_commit. Nothing is copied.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li slot's address: success
+ *    \li NULL: failed, fifo is full
+ */
+#define gfifo_reserve(_fifo, _type)                                           \
+  ({                                                                          \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    __gfifo_stat_room (_tmp, __gfifo_prod_space (_tmp, 1))                    \
+        ? __gfifo_slot (_tmp, _tmp->in, _type)                                \
+        : (_type *)NULL;                                                      \
+  })
+
+/**
+ * @brief insert the element previously obtained with gfifo_reserve
+ *
+ * @param [inout] _fifo: fifo's address
+ */
+#define gfifo_commit(_fifo) gfifo_commit_n (_fifo, 1)
+
+/**
+ * @brief get the address of the oldest element for in place consuming
+ *
+ * The element stays in the fifo, and its slot may not be reused by the
+ * producer, until gfifo_release. Nothing is copied.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li element's address: success
+ *    \li NULL: failed, fifo is empty
+ */
+#define gfifo_acquire(_fifo, _type)                                           \
+  ({                                                                          \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    __gfifo_stat_avail (_tmp, __gfifo_cons_count (_tmp, 1))                   \
+        ? __gfifo_slot (_tmp, _tmp->out, _type)                               \
+        : (_type *)NULL;                                                      \
+  })
+
+/**
+ * @brief remove the element previously obtained with gfifo_acquire
+ *
+ * @param [inout] _fifo: fifo's address
+ */
+#define gfifo_release(_fifo) gfifo_release_n (_fifo, 1)
+
+/**
+ * @brief get the free area of the fifo as up to two contiguous spans
+ *
+ * The second span is only non-empty when the free area wraps around the
+ * end of the buffer. Elements written there are inserted by gfifo_commit_n.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [out] _spans: array of two struct gfifo_span
+ * @param [in] _type: element's type
+ *
+ * @retval: number of free elements, sum of both spans' @c len
+ */
+#define gfifo_writable_spans(_fifo, _spans, _type)                            \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    struct gfifo_span *_tmpsp = _spans;                                       \
+    unsigned int _tmpoff = __gfifo_idx (_tmp, _tmp->in);                      \
+    unsigned int _tmpcnt                                                      \
+        = __gfifo_prod_space (_tmp, __gfifo_capacity (_tmp));                 \
+    unsigned int _tmpfirst = __gfifo_first_run (_tmp, _tmpoff, _tmpcnt);      \
+    _tmpsp[0].base = (_type *)__gfifo_data (_tmp) + _tmpoff;                  \
+    _tmpsp[0].len = _tmpfirst;                                                \
+    _tmpsp[1].base = __gfifo_data (_tmp);                                     \
+    _tmpsp[1].len = _tmpcnt - _tmpfirst;                                      \
+    _tmpcnt;                                                                  \
+  })
+
+/**
+ * @brief get the stored elements as up to two contiguous spans
+ *
+ * The second span is only non-empty when the elements wrap around the end
+ * of the buffer. Elements read there are removed by gfifo_release_n.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [out] _spans: array of two struct gfifo_span
+ * @param [in] _type: element's type
+ *
+ * @retval: number of stored elements, sum of both spans' @c len
+ */
+#define gfifo_readable_spans(_fifo, _spans, _type)                            \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    struct gfifo_span *_tmpsp = _spans;                                       \
+    unsigned int _tmpoff = __gfifo_idx (_tmp, _tmp->out);                     \
+    unsigned int _tmpcnt                                                      \
+        = __gfifo_cons_count (_tmp, __gfifo_capacity (_tmp));                 \
+    unsigned int _tmpfirst = __gfifo_first_run (_tmp, _tmpoff, _tmpcnt);      \
+    _tmpsp[0].base = (_type *)__gfifo_data (_tmp) + _tmpoff;                  \
+    _tmpsp[0].len = _tmpfirst;                                                \
+    _tmpsp[1].base = __gfifo_data (_tmp);                                     \
+    _tmpsp[1].len = _tmpcnt - _tmpfirst;                                      \
+    _tmpcnt;                                                                  \
+  })
+
+/**
+ * @brief insert number of element written in place
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _len: number of elements, at most what gfifo_reserve or
+ *                   gfifo_writable_spans made available
+ */
+#define gfifo_commit_n(_fifo, _len)                                           \
+  ({                                                                          \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    __gfifo_publish_in (_tmp, __gfifo_next (_tmp, _tmp->in, _len));           \
+  })
+
+/**
+ * @brief remove number of element consumed in place
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _len: number of elements, at most what gfifo_acquire or
+ *                   gfifo_readable_spans made available
+ */
+#define gfifo_release_n(_fifo, _len)                                          \
+  ({                                                                          \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    __gfifo_publish_out (_tmp, __gfifo_next (_tmp, _tmp->out, _len));         \
+  })
+
+/* copy _len elements into the buffer at slot _off, split at the wrap */
+#define __gfifo_copy_in(_fifo, _off, _src, _len, _type)                       \
+  ({                                                                          \
+    unsigned int _tmpfirst = __gfifo_first_run (_fifo, _off, _len);           \
+    __gfifo_slot_copy ((_type *)__gfifo_data (_fifo) + (_off), (_src),        \
+                       sizeof (_type) * _tmpfirst);                           \
+    if ((_len) > _tmpfirst)                                                   \
+      __gfifo_slot_copy (__gfifo_data (_fifo), (_src) + _tmpfirst,            \
+                         sizeof (_type) * ((_len) - _tmpfirst));              \
+  })
+
+/* copy _len elements out of the buffer from slot _off, split at the wrap */
+#define __gfifo_copy_out(_fifo, _off, _dst, _len, _type)                      \
+  ({                                                                          \
+    unsigned int _tmpfirst = __gfifo_first_run (_fifo, _off, _len);           \
+    __gfifo_slot_copy ((_dst), (_type *)__gfifo_data (_fifo) + (_off),        \
+                       sizeof (_type) * _tmpfirst);                           \
+    if ((_len) > _tmpfirst)                                                   \
+      __gfifo_slot_copy ((_dst) + _tmpfirst, __gfifo_data (_fifo),            \
+                         sizeof (_type) * ((_len) - _tmpfirst));              \
+  })
+
 /**
  * @brief insert number of element into fifo
  *
+ * Either all @c _len elements are inserted or none. The free space is
+ * computed once, the elements are copied with at most two memcpy and
+ * @c in is published once.
+ *
  * @param [inout] _fifo: fifo's address
- * @param [in] _value: element's address
+ * @param [in] _array: elements' address
+ * @param [in] _len: number of elements
  * @param [in] _type: element's type
  *
  * @retval:
@@ -184,23 +1362,15 @@ struct gfifo
     unsigned int _ret;                                                        \
     typeof (_fifo + 1) _tmp = _fifo;                                          \
     typeof (_array + 1) _tmparr = _array;                                     \
-    _ret = ((gfifo_vaild_count (_fifo) + _len) < _tmp->size);                 \
+    unsigned int _tmplen = _len;                                              \
+    unsigned int _tmpin = _tmp->in;                                           \
+    _ret = __gfifo_stat_room (                                                \
+        _tmp, __gfifo_prod_space (_tmp, _tmplen) >= _tmplen);                 \
     if (_ret)                                                                 \
       {                                                                       \
-        if (_tmp->in + _len < _tmp->size)                                     \
-          {                                                                   \
-            memcpy ((_type *)_tmp->data + _tmp->in, _tmparr,                  \
-                    sizeof (_type) * _len);                                   \
-          }                                                                   \
-        else                                                                  \
-          {                                                                   \
-            memcpy ((_type *)_tmp->data + _tmp->in, _tmparr,                  \
-                    sizeof (_type) * (_tmp->size - _tmp->in));                \
-            memcpy ((_type *)_tmp->data,                                      \
-                    _tmparr + (_len - (_tmp->size - _tmp->in)),               \
-                    sizeof (_type) * (_len - (_tmp->size - _tmp->in)));       \
-          }                                                                   \
-        _tmp->in = (_tmp->in + _len) & _tmp->mask;                            \
+        __gfifo_copy_in (_tmp, __gfifo_idx (_tmp, _tmpin), _tmparr, _tmplen,  \
+                         _type);                                              \
+        __gfifo_publish_in (_tmp, __gfifo_next (_tmp, _tmpin, _tmplen));      \
       }                                                                       \
     _ret;                                                                     \
   })
@@ -208,8 +1378,13 @@ struct gfifo
 /**
  * @brief remove number of element from fifo
  *
+ * Either all @c _len elements are removed or none. The element count is
+ * computed once, the elements are copied with at most two memcpy and
+ * @c out is published once.
+ *
  * @param [inout] _fifo: fifo's address
- * @param [in] _value: element's address
+ * @param [out] _array: elements' address
+ * @param [in] _len: number of elements
  * @param [in] _type: element's type
  *
  * @retval:
@@ -221,25 +1396,270 @@ struct gfifo
     unsigned int _ret;                                                        \
     typeof (_fifo + 1) _tmp = _fifo;                                          \
     typeof (_array + 1) _tmparr = _array;                                     \
-    _ret = (gfifo_vaild_count (_fifo) >= _len);                               \
-    {                                                                         \
-      if (_ret)                                                               \
-        {                                                                     \
-          if (_tmp->out + _len < _tmp->size)                                  \
-            {                                                                 \
-              memcpy (_tmparr, (_type *)_tmp->data + _tmp->out,               \
-                      sizeof (_type) * _len);                                 \
-            }                                                                 \
-          else                                                                \
-            {                                                                 \
-              memcpy (_tmparr, (_type *)_tmp->data + _tmp->out,               \
-                      sizeof (_type) *  (_tmp->size - _tmp->out));    \
-              memcpy (_tmparr + (_len - (_tmp->size - _tmp->out)),            \
-                      (_type *)_tmp->data,                                    \
-                      sizeof (_type) * (_len - (_tmp->size - _tmp->out)));    \
-            }                                                                 \
-          _tmp->out = (_tmp->out + _len) & _tmp->mask;                        \
-        }                                                                     \
-    }                                                                         \
+    unsigned int _tmplen = _len;                                              \
+    unsigned int _tmpout = _tmp->out;                                         \
+    _ret = __gfifo_stat_avail (                                               \
+        _tmp, __gfifo_cons_count (_tmp, _tmplen) >= _tmplen);                 \
+    if (_ret)                                                                 \
+      {                                                                       \
+        __gfifo_copy_out (_tmp, __gfifo_idx (_tmp, _tmpout), _tmparr,         \
+                          _tmplen, _type);                                    \
+        __gfifo_publish_out (_tmp, __gfifo_next (_tmp, _tmpout, _tmplen));    \
+      }                                                                       \
     _ret;                                                                     \
   })
+
+/**
+ * @brief insert up to number of element into fifo
+ *
+ * Inserts as many of the @c _len elements as fit, like kfifo_in, so the
+ * producer always makes progress in one call.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _array: elements' address
+ * @param [in] _len: maximum number of elements
+ * @param [in] _type: element's type
+ *
+ * @retval: number of elements inserted
+ */
+#define gfifo_insert_upto(_fifo, _array, _len, _type)                         \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_array + 1) _tmparr = _array;                                     \
+    unsigned int _tmplen = _len;                                              \
+    unsigned int _tmpin = _tmp->in;                                           \
+    unsigned int _tmpcnt = __gfifo_prod_space (_tmp, _tmplen);                \
+    if (_tmpcnt > _tmplen)                                                    \
+      _tmpcnt = _tmplen;                                                      \
+    if (__gfifo_stat_room (_tmp, _tmpcnt))                                    \
+      {                                                                       \
+        __gfifo_copy_in (_tmp, __gfifo_idx (_tmp, _tmpin), _tmparr, _tmpcnt,  \
+                         _type);                                              \
+        __gfifo_publish_in (_tmp, __gfifo_next (_tmp, _tmpin, _tmpcnt));      \
+      }                                                                       \
+    _tmpcnt;                                                                  \
+  })
+
+/**
+ * @brief remove up to number of element from fifo
+ *
+ * Removes as many of the @c _len elements as are available, like
+ * kfifo_out, so the consumer always makes progress in one call.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [out] _array: elements' address
+ * @param [in] _len: maximum number of elements
+ * @param [in] _type: element's type
+ *
+ * @retval: number of elements removed
+ */
+#define gfifo_remove_upto(_fifo, _array, _len, _type)                         \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_array + 1) _tmparr = _array;                                     \
+    unsigned int _tmplen = _len;                                              \
+    unsigned int _tmpout = _tmp->out;                                         \
+    unsigned int _tmpcnt = __gfifo_cons_count (_tmp, _tmplen);                \
+    if (_tmpcnt > _tmplen)                                                    \
+      _tmpcnt = _tmplen;                                                      \
+    if (__gfifo_stat_avail (_tmp, _tmpcnt))                                   \
+      {                                                                       \
+        __gfifo_copy_out (_tmp, __gfifo_idx (_tmp, _tmpout), _tmparr,         \
+                          _tmpcnt, _type);                                    \
+        __gfifo_publish_out (_tmp, __gfifo_next (_tmp, _tmpout, _tmpcnt));    \
+      }                                                                       \
+    _tmpcnt;                                                                  \
+  })
+
+/**
+ * @brief process up to number of element in place, then remove them
+ *
+ * Reads @c in once, calls @c _fn (element's address, @c _ctx) on each of
+ * the up to @c _max oldest elements, across both wrap spans, and publishes
+ * @c out once at the end. Nothing is copied; the elements may not be used
+ * after @c _fn returns.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _max: maximum number of elements
+ * @param [in] _fn: visitor, called as @c _fn (_type *, @c _ctx)
+ * @param [in] _ctx: visitor's context, passed through
+ * @param [in] _type: element's type
+ *
+ * @retval: number of elements consumed
+ */
+#define gfifo_consume(_fifo, _max, _fn, _ctx, _type)                          \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    unsigned int _tmpmax = _max;                                              \
+    unsigned int _tmpout = _tmp->out;                                         \
+    unsigned int _tmpoff = __gfifo_idx (_tmp, _tmpout);                       \
+    unsigned int _tmpcnt = __gfifo_cons_count (_tmp, _tmpmax);                \
+    unsigned int _tmpfirst, _tmpi;                                            \
+    _type *_tmpp = (_type *)__gfifo_data (_tmp) + _tmpoff;                    \
+    if (_tmpcnt > _tmpmax)                                                    \
+      _tmpcnt = _tmpmax;                                                      \
+    _tmpfirst = __gfifo_first_run (_tmp, _tmpoff, _tmpcnt);                   \
+    for (_tmpi = 0; _tmpi < _tmpfirst; _tmpi++)                               \
+      _fn (_tmpp + _tmpi, _ctx);                                              \
+    _tmpp = (_type *)__gfifo_data (_tmp);                                     \
+    for (_tmpi = 0; _tmpi < _tmpcnt - _tmpfirst; _tmpi++)                     \
+      _fn (_tmpp + _tmpi, _ctx);                                              \
+    if (__gfifo_stat_avail (_tmp, _tmpcnt))                                   \
+      __gfifo_publish_out (_tmp, __gfifo_next (_tmp, _tmpout, _tmpcnt));      \
+    _tmpcnt;                                                                  \
+  })
+
+#ifdef GFIFO_STATS
+/**
+ * @brief copy a fifo's counters, may be called from any thread
+ *
+ * The counters are read one by one while both sides keep going, so they
+ * are each exact but not taken at the same instant.
+ *
+ * @param [in] _fifo: fifo's address
+ * @param [out] _stats: struct gfifo_stats to fill
+ * @param [in] _type: element's type, to turn element counts into bytes
+ */
+#define gfifo_stats_snapshot(_fifo, _stats, _type)                            \
+  ({                                                                          \
+    typeof (_fifo + 1) _tmps = _fifo;                                         \
+    struct gfifo_stats *_tmpst = _stats;                                      \
+    _tmpst->insert_ok                                                         \
+        = __atomic_load_n (&_tmps->prod_stats.ok, __ATOMIC_RELAXED);          \
+    _tmpst->insert_full                                                       \
+        = __atomic_load_n (&_tmps->prod_stats.full, __ATOMIC_RELAXED);        \
+    _tmpst->insert_bytes                                                      \
+        = __atomic_load_n (&_tmps->prod_stats.elems, __ATOMIC_RELAXED)        \
+          * sizeof (_type);                                                   \
+    _tmpst->max_used                                                          \
+        = __atomic_load_n (&_tmps->prod_stats.max_used, __ATOMIC_RELAXED);    \
+    _tmpst->remove_ok                                                         \
+        = __atomic_load_n (&_tmps->cons_stats.ok, __ATOMIC_RELAXED);          \
+    _tmpst->remove_empty                                                      \
+        = __atomic_load_n (&_tmps->cons_stats.empty, __ATOMIC_RELAXED);       \
+    _tmpst->remove_bytes                                                      \
+        = __atomic_load_n (&_tmps->cons_stats.elems, __ATOMIC_RELAXED)        \
+          * sizeof (_type);                                                   \
+    _tmpst->used = gfifo_vaild_count (_tmps);                                 \
+  })
+#endif
+
+#ifdef GFIFO_WAIT
+/**
+ * @brief insert an element into fifo, waiting for free space
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _value: element's address
+ * @param [in] _type: element's type
+ * @param [in] _timeout_ms: maximum time to wait, negative waits forever
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, timed out
+ */
+#define gfifo_insert_wait(_fifo, _value, _type, _timeout_ms)                  \
+  (unsigned int)({                                                            \
+    unsigned int _retw, _tmpround = 0, _tmpparked = 0;                        \
+    typeof (_fifo + 1) _tmpw = _fifo;                                         \
+    typeof (_value + 1) _tmpwv = _value;                                      \
+    struct timespec _tmpdl;                                                   \
+    __gfifo_deadline (&_tmpdl, _timeout_ms);                                  \
+    while (!(_retw = gfifo_insert (_tmpw, _tmpwv, _type)))                    \
+      {                                                                       \
+        unsigned int _tmpseen;                                                \
+        if (__gfifo_spin (_tmpw->prod_spin, &_tmpround))                      \
+          continue;                                                           \
+        _tmpparked = 1;                                                       \
+        __atomic_store_n (&_tmpw->prod_waiting, 1, __ATOMIC_SEQ_CST);         \
+        _tmpseen = __atomic_load_n (&_tmpw->out, __ATOMIC_SEQ_CST);           \
+        if (__gfifo_used (_tmpw, _tmpw->in, _tmpseen)                         \
+            == __gfifo_capacity (_tmpw))                                      \
+          __gfifo_park (&_tmpw->out, _tmpseen, &_tmpdl);                      \
+        __atomic_store_n (&_tmpw->prod_waiting, 0, __ATOMIC_RELAXED);         \
+        if (__gfifo_expired (&_tmpdl))                                        \
+          {                                                                   \
+            _retw = gfifo_insert (_tmpw, _tmpwv, _type);                      \
+            break;                                                            \
+          }                                                                   \
+      }                                                                       \
+    __gfifo_spin_adapt (&_tmpw->prod_spin, _tmpround, _tmpparked);            \
+    _retw;                                                                    \
+  })
+
+/**
+ * @brief remove an element from fifo, waiting for one to arrive
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _value: element's address
+ * @param [in] _type: element's type
+ * @param [in] _timeout_ms: maximum time to wait, negative waits forever
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, timed out
+ */
+#define gfifo_remove_wait(_fifo, _value, _type, _timeout_ms)                  \
+  (unsigned int)({                                                            \
+    unsigned int _retw, _tmpround = 0, _tmpparked = 0;                        \
+    typeof (_fifo + 1) _tmpw = _fifo;                                         \
+    typeof (_value + 1) _tmpwv = _value;                                      \
+    struct timespec _tmpdl;                                                   \
+    __gfifo_deadline (&_tmpdl, _timeout_ms);                                  \
+    while (!(_retw = gfifo_remove (_tmpw, _tmpwv, _type)))                    \
+      {                                                                       \
+        unsigned int _tmpseen = _tmpw->out;                                   \
+        if (__gfifo_spin (_tmpw->cons_spin, &_tmpround))                      \
+          continue;                                                           \
+        _tmpparked = 1;                                                       \
+        __atomic_store_n (&_tmpw->cons_waiting, 1, __ATOMIC_SEQ_CST);         \
+        if (__atomic_load_n (&_tmpw->in, __ATOMIC_SEQ_CST) == _tmpseen)       \
+          __gfifo_park (&_tmpw->in, _tmpseen, &_tmpdl);                       \
+        __atomic_store_n (&_tmpw->cons_waiting, 0, __ATOMIC_RELAXED);         \
+        if (__gfifo_expired (&_tmpdl))                                        \
+          {                                                                   \
+            _retw = gfifo_remove (_tmpw, _tmpwv, _type);                      \
+            break;                                                            \
+          }                                                                   \
+      }                                                                       \
+    __gfifo_spin_adapt (&_tmpw->cons_spin, _tmpround, _tmpparked);            \
+    _retw;                                                                    \
+  })
+#endif
+
+#ifdef GFIFO_OVERWRITE
+#ifdef __cplusplus
+#define __gfifo_static_assert static_assert
+#else
+#define __gfifo_static_assert _Static_assert
+#endif
+
+/* consumer macros that read slots the producer may be overwriting */
+#define __gfifo_overwrite_unsafe(_name)                                       \
+  ({                                                                          \
+    __gfifo_static_assert (0, #_name " is not safe with GFIFO_OVERWRITE, "    \
+                              "use gfifo_remove");                            \
+    0U;                                                                       \
+  })
+
+#undef gfifo_peek
+#undef gfifo_peek_at
+#undef gfifo_throw
+#undef gfifo_acquire
+#undef gfifo_release_n
+#undef gfifo_readable_spans
+#undef gfifo_remove_array
+#undef gfifo_remove_upto
+#undef gfifo_consume
+#define gfifo_peek(...) __gfifo_overwrite_unsafe (gfifo_peek)
+#define gfifo_peek_at(...) __gfifo_overwrite_unsafe (gfifo_peek_at)
+#define gfifo_throw(...) __gfifo_overwrite_unsafe (gfifo_throw)
+#define gfifo_acquire(...) __gfifo_overwrite_unsafe (gfifo_acquire)
+#define gfifo_release_n(...) __gfifo_overwrite_unsafe (gfifo_release)
+#define gfifo_readable_spans(...)                                             \
+  __gfifo_overwrite_unsafe (gfifo_readable_spans)
+#define gfifo_remove_array(...) __gfifo_overwrite_unsafe (gfifo_remove_array)
+#define gfifo_remove_upto(...) __gfifo_overwrite_unsafe (gfifo_remove_upto)
+#define gfifo_consume(...) __gfifo_overwrite_unsafe (gfifo_consume)
+#endif
+
+#endif /* __GFIFO_H__ */
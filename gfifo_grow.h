@@ -0,0 +1,305 @@
+/**
+ * @file gfifo_grow.h
+ * @brief Single producer / single consumer fifo that grows and shrinks
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * Same @c _type parameterised interface as gfifo.h, but the buffer is a
+ * heap segment the producer may replace at any time. When an insert finds
+ * the fifo full it allocates a segment twice the size (up to @c max_size),
+ * copies the live elements over with at most two memcpy, and publishes the
+ * new segment with a release store; the consumer keeps reading from the old
+ * one until it loads the new pointer, so it never waits for a resize.
+ * gfifo_grow_shrink does the opposite when the producer finds the fifo
+ * mostly idle, down to @c min_size.
+ *
+ * @c in and @c out are free running sequence numbers, only masked by the
+ * segment that is being addressed, so they carry over a resize unchanged.
+ *
+ * A replaced segment is linked from its successor and freed by the
+ * consumer: there is only one consumer, so once it has loaded the new
+ * segment it can no longer be reading an older one and that load is the
+ * grace period. Until then the old buffer stays allocated.
+ */
+
+#ifndef __GFIFO_GROW_H__
+#define __GFIFO_GROW_H__
+
+#include "gfifo.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/**
+ * @brief Buffer of a growable fifo
+ */
+struct gfifo_grow_seg
+{
+  struct gfifo_grow_seg *prev; /* replaced segments, freed by the consumer */
+  unsigned int size;
+  unsigned int mask;
+  unsigned char data[] __attribute__ ((aligned (GFIFO_CACHELINE_SIZE)));
+};
+
+/**
+ * @brief Generic Circular growable SPSC FIFO
+ */
+struct gfifo_grow
+{
+  /* producer */
+  struct gfifo_grow_seg *seg __attribute__ ((aligned (GFIFO_CACHELINE_SIZE)));
+  unsigned int in;
+  unsigned int min_size;
+  unsigned int max_size;
+
+  /* consumer */
+  unsigned int out __attribute__ ((aligned (GFIFO_CACHELINE_SIZE)));
+} __attribute__ ((aligned (GFIFO_CACHELINE_SIZE)));
+
+static inline struct gfifo_grow_seg *
+__gfifo_grow_seg_alloc (unsigned int size, size_t esize)
+{
+  size_t bytes = offsetof (struct gfifo_grow_seg, data) + size * esize;
+  struct gfifo_grow_seg *seg;
+
+  /* aligned_alloc wants a multiple of the alignment */
+  bytes = (bytes + GFIFO_CACHELINE_SIZE - 1) & ~(size_t)(GFIFO_CACHELINE_SIZE
+                                                         - 1);
+  seg = (struct gfifo_grow_seg *)aligned_alloc (GFIFO_CACHELINE_SIZE, bytes);
+  if (seg)
+    {
+      seg->prev = NULL;
+      seg->size = size;
+      seg->mask = size - 1;
+    }
+  return seg;
+}
+
+/* free every segment replaced by seg */
+static inline void
+__gfifo_grow_reclaim (struct gfifo_grow_seg *seg)
+{
+  struct gfifo_grow_seg *old = seg->prev, *prev;
+
+  seg->prev = NULL;
+  for (; old; old = prev)
+    {
+      prev = old->prev;
+      free (old);
+    }
+}
+
+/**
+ * @brief move a fifo's elements to a new segment, from the producer
+ *
+ * Both sizes are powers of two and the live elements fit in the smaller
+ * one, so a wrap of the larger ring is also a wrap of the smaller and the
+ * elements form at most two runs that are contiguous in both.
+ *
+ * @param[inout] fifo: fifo's address
+ * @param[in] size: new segment's size, a power of two
+ * @param[in] esize: element's size
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, out of memory or more than @p size elements stored
+ */
+static inline unsigned int
+__gfifo_grow_resize (struct gfifo_grow *fifo, unsigned int size, size_t esize)
+{
+  struct gfifo_grow_seg *old = fifo->seg, *seg;
+  unsigned int in = fifo->in, out, cnt, run, small;
+
+  /* elements the consumer removes while copying are copied for nothing */
+  out = __atomic_load_n (&fifo->out, __ATOMIC_ACQUIRE);
+  cnt = in - out;
+  if (cnt > size)
+    return 0;
+  seg = __gfifo_grow_seg_alloc (size, esize);
+  if (!seg)
+    return 0;
+
+  small = size < old->size ? size : old->size;
+  run = small - (out & (small - 1));
+  if (run > cnt)
+    run = cnt;
+  memcpy (seg->data + (out & seg->mask) * esize,
+          old->data + (out & old->mask) * esize, run * esize);
+  out += run;
+  memcpy (seg->data + (out & seg->mask) * esize,
+          old->data + (out & old->mask) * esize, (cnt - run) * esize);
+
+  seg->prev = old;
+  __atomic_store_n (&fifo->seg, seg, __ATOMIC_RELEASE);
+  return 1;
+}
+
+/**
+ * @brief Initialize a growable fifo structure
+ *
+ * @param[inout] _fifo: fifo's address
+ * @param[in] _min_size: initial and smallest size, a power of two
+ * @param[in] _max_size: largest size, a power of two, at most 2^31
+ * @param[in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, out of memory
+ */
+#define gfifo_grow_init(_fifo, _min_size, _max_size, _type)                   \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    _tmp->min_size = _min_size;                                               \
+    _tmp->max_size = _max_size;                                               \
+    _tmp->seg = __gfifo_grow_seg_alloc (_tmp->min_size, sizeof (_type));      \
+    _tmp->in = 0;                                                             \
+    __atomic_store_n (&_tmp->out, 0, __ATOMIC_RELEASE);                       \
+    _tmp->seg != NULL;                                                        \
+  })
+
+/**
+ * @brief free a growable fifo's segments
+ *
+ * Must not race with any insert or remove.
+ *
+ * @param[inout] _fifo: fifo's address
+ */
+#define gfifo_grow_deinit(_fifo)                                              \
+  ({                                                                          \
+    typeof (_fifo + 1) _tmpg = _fifo;                                         \
+    if (_tmpg->seg)                                                           \
+      {                                                                       \
+        __gfifo_grow_reclaim (_tmpg->seg);                                    \
+        free (_tmpg->seg);                                                    \
+        _tmpg->seg = NULL;                                                    \
+      }                                                                       \
+  })
+
+/**
+ * @brief return fifo's current size
+ *
+ * @param [in] _fifo: fifo's address
+ */
+#define gfifo_grow_size(_fifo)                                                \
+  (__atomic_load_n (&(_fifo)->seg, __ATOMIC_ACQUIRE)->size)
+
+/**
+ * @brief return number of element in fifo
+ *
+ * Only a snapshot when called from neither side.
+ *
+ * @param [in] _fifo: fifo's address
+ */
+#define gfifo_grow_vaild_count(_fifo)                                         \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    unsigned int _tmpout = __atomic_load_n (&_tmp->out, __ATOMIC_ACQUIRE);    \
+    __atomic_load_n (&_tmp->in, __ATOMIC_ACQUIRE) - _tmpout;                  \
+  })
+
+/**
+ * @brief return true if fifo is empty
+ *
+ * @param [in] _fifo: fifo's address
+ */
+#define gfifo_grow_empty(_fifo) (gfifo_grow_vaild_count (_fifo) == 0)
+
+/**
+ * @brief insert an element into fifo, growing it when full
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _value: element's address
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, fifo is full at @c max_size or out of memory
+ */
+#define gfifo_grow_insert(_fifo, _value, _type)                               \
+  (unsigned int)({                                                            \
+    unsigned int _ret = 1;                                                    \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_value + 1) _tmpv = _value;                                       \
+    struct gfifo_grow_seg *_tmpseg = _tmp->seg;                               \
+    unsigned int _tmpin = _tmp->in;                                           \
+    if (_tmpin - __atomic_load_n (&_tmp->out, __ATOMIC_ACQUIRE)               \
+        >= _tmpseg->size)                                                     \
+      {                                                                       \
+        if (_tmpseg->size < _tmp->max_size                                    \
+            && __gfifo_grow_resize (_tmp, _tmpseg->size * 2, sizeof (_type))) \
+          _tmpseg = _tmp->seg;                                                \
+        else                                                                  \
+          _ret = 0;                                                           \
+      }                                                                       \
+    if (_ret)                                                                 \
+      {                                                                       \
+        memcpy ((_type *)_tmpseg->data + (_tmpin & _tmpseg->mask), _tmpv,     \
+                sizeof (_type));                                              \
+        __atomic_store_n (&_tmp->in, _tmpin + 1, __ATOMIC_RELEASE);           \
+      }                                                                       \
+    _ret;                                                                     \
+  })
+
+/**
+ * @brief remove an element from fifo
+ *
+ * Also frees the segments a resize replaced once they are out of use.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [out] _value: element's address
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed
+ */
+#define gfifo_grow_remove(_fifo, _value, _type)                               \
+  (unsigned int)({                                                            \
+    unsigned int _ret = 0;                                                    \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_value + 1) _tmpv = _value;                                       \
+    unsigned int _tmpout = _tmp->out;                                         \
+    /* in first: an element past the resize implies the new segment */        \
+    if (__atomic_load_n (&_tmp->in, __ATOMIC_ACQUIRE) != _tmpout)             \
+      {                                                                       \
+        struct gfifo_grow_seg *_tmpseg                                        \
+            = __atomic_load_n (&_tmp->seg, __ATOMIC_ACQUIRE);                 \
+        if (_tmpseg->prev)                                                    \
+          __gfifo_grow_reclaim (_tmpseg);                                     \
+        memcpy (_tmpv, (_type *)_tmpseg->data + (_tmpout & _tmpseg->mask),    \
+                sizeof (_type));                                              \
+        __atomic_store_n (&_tmp->out, _tmpout + 1, __ATOMIC_RELEASE);         \
+        _ret = 1;                                                             \
+      }                                                                       \
+    _ret;                                                                     \
+  })
+
+/**
+ * @brief shrink an idle fifo, from the producer
+ *
+ * Halves the size while the stored elements take at most a quarter of it
+ * and it stays at least @c min_size, then moves them in one resize. The
+ * quarter leaves room for bursts, so a shrink is not undone by the next
+ * insert.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success, fifo is smaller
+ *    \li 0: failed, fifo is busy, already at @c min_size or out of memory
+ */
+#define gfifo_grow_shrink(_fifo, _type)                                       \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    unsigned int _tmpsize = _tmp->seg->size;                                  \
+    unsigned int _tmpcnt                                                      \
+        = _tmp->in - __atomic_load_n (&_tmp->out, __ATOMIC_ACQUIRE);          \
+    while (_tmpsize / 2 >= _tmp->min_size && _tmpcnt <= _tmpsize / 4)         \
+      _tmpsize /= 2;                                                          \
+    _tmpsize < _tmp->seg->size                                                \
+        && __gfifo_grow_resize (_tmp, _tmpsize, sizeof (_type));              \
+  })
+
+#endif /* __GFIFO_GROW_H__ */
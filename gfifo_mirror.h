@@ -0,0 +1,146 @@
+/**
+ * @file gfifo_mirror.h
+ * @brief Double mapped buffers for wrap free fifo access
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * gfifo_mirror_alloc maps the same physical pages twice, back to back, so
+ * that byte @c i and byte @c i + @c bytes of the returned buffer alias.
+ * Used as a fifo's @c data with GFIFO_MIRRORED, any run of up to @c size
+ * elements is contiguous in virtual memory: the batched macros need no wrap
+ * branch and parsers can read a record straight across the boundary.
+ *
+ * Including this file before gfifo.h enables GFIFO_MIRRORED, so every fifo
+ * in the translation unit must then use a mirrored buffer.
+ *
+ * Linux only (memfd_create + mmap), build with _GNU_SOURCE defined.
+ */
+
+#ifndef __GFIFO_MIRROR_H__
+#define __GFIFO_MIRROR_H__
+
+#ifndef GFIFO_MIRRORED
+#ifdef __GFIFO_H__
+#error "gfifo.h included without GFIFO_MIRRORED, include gfifo_mirror.h first"
+#endif
+#define GFIFO_MIRRORED
+#endif
+
+#include "gfifo.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * @brief allocate a mirrored fifo buffer
+ *
+ * @param[in] bytes: buffer's size, a multiple of the page size
+ *                   (i.e. @c size * sizeof (_type) of the fifo)
+ *
+ * @retval:
+ *    \li buffer's address: success, @c 2 * @p bytes of address space
+ *    \li NULL: failed, errno is set
+ */
+static inline void *
+gfifo_mirror_alloc (size_t bytes)
+{
+  long page = sysconf (_SC_PAGESIZE);
+  unsigned char *base;
+  int fd;
+
+  if (!bytes || bytes % page)
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+
+  fd = memfd_create ("gfifo", MFD_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+  if (ftruncate (fd, bytes) < 0)
+    goto err_close;
+
+  /* reserve both halves first so nothing else lands in between */
+  base = (unsigned char *)mmap (NULL, 2 * bytes, PROT_NONE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    goto err_close;
+  if (mmap (base, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+            0)
+          == MAP_FAILED
+      || mmap (base + bytes, bytes, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_FIXED, fd, 0)
+             == MAP_FAILED)
+    {
+      int err = errno;
+      munmap (base, 2 * bytes);
+      close (fd);
+      errno = err;
+      return NULL;
+    }
+
+  /* the mappings keep the pages alive */
+  close (fd);
+  return base;
+
+err_close:
+  {
+    int err = errno;
+    close (fd);
+    errno = err;
+  }
+  return NULL;
+}
+
+/**
+ * @brief free a buffer obtained from gfifo_mirror_alloc
+ *
+ * @param[in] buf: buffer's address
+ * @param[in] bytes: size passed to gfifo_mirror_alloc
+ */
+static inline void
+gfifo_mirror_free (void *buf, size_t bytes)
+{
+  if (buf)
+    munmap (buf, 2 * bytes);
+}
+
+/**
+ * @brief allocate a mirrored buffer and initialize a fifo with it
+ *
+ * @param[inout] _fifo: fifo's address
+ * @param[in] _size: fifo's size, a power of two with
+ *                   @c _size * sizeof (_type) a multiple of the page size
+ * @param[in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, errno is set
+ */
+#define gfifo_mirror_init(_fifo, _size, _type)                                \
+  (unsigned int)({                                                            \
+    unsigned int _tmpsize = _size;                                            \
+    void *_tmpbuf = gfifo_mirror_alloc ((size_t)_tmpsize * sizeof (_type));   \
+    if (_tmpbuf)                                                              \
+      gfifo_init (_fifo, _tmpbuf, _tmpsize);                                  \
+    _tmpbuf != NULL;                                                          \
+  })
+
+/**
+ * @brief release the buffer of a fifo set up with gfifo_mirror_init
+ *
+ * @param[inout] _fifo: fifo's address
+ * @param[in] _type: element's type
+ */
+#define gfifo_mirror_deinit(_fifo, _type)                                     \
+  ({                                                                          \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    gfifo_mirror_free (__gfifo_data (_tmp),                                   \
+                       (size_t)_tmp->size * sizeof (_type));                  \
+    __gfifo_set_data (_tmp, NULL);                                            \
+  })
+
+#endif /* __GFIFO_MIRROR_H__ */
@@ -0,0 +1,190 @@
+/**
+ * @file gfifo_mpmc.h
+ * @brief Multi producer / multi consumer bounded circular queue
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * Same power-of-two @c mask indexing and @c _type parameterised interface as
+ * gfifo.h, but any number of threads may insert and remove concurrently.
+ * Every slot carries a sequence number (Vyukov's bounded queue): a producer
+ * claims a slot by advancing @c in with a CAS once the slot's sequence says
+ * it is free, copies the element and then publishes the slot by bumping its
+ * sequence; consumers do the mirror image on @c out. Threads only contend
+ * on the index they move and on the slot they claimed, never on a lock.
+ *
+ * @c in and @c out are free running, so all @c size slots can be used.
+ */
+
+#ifndef __GFIFO_MPMC_H__
+#define __GFIFO_MPMC_H__
+
+#include "gfifo.h"
+
+/**
+ * @brief Generic Circular MPMC FIFO
+ */
+struct gfifo_mpmc
+{
+  void *data;
+  unsigned int *seq;
+  unsigned int size;
+  unsigned int mask;
+
+  /* producers */
+  unsigned int in __attribute__ ((aligned (GFIFO_CACHELINE_SIZE)));
+
+  /* consumers */
+  unsigned int out __attribute__ ((aligned (GFIFO_CACHELINE_SIZE)));
+} __attribute__ ((aligned (GFIFO_CACHELINE_SIZE)));
+
+/**
+ * @brief Initialize a mpmc fifo structure
+ *
+ * Must not race with any insert or remove.
+ *
+ * @param[inout] _fifo: fifo's address
+ * @param[in] _buf: fifo's buffer, @c _size elements
+ * @param[in] _seq: sequence array, @c _size unsigned int
+ * @param[in] _size: fifo's size, must be a power of two
+ */
+#define gfifo_mpmc_init(_fifo, _buf, _seq, _size)                             \
+  ({                                                                          \
+    unsigned int _tmpi;                                                       \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    _tmp->data = _buf;                                                        \
+    _tmp->seq = _seq;                                                         \
+    _tmp->size = _size;                                                       \
+    _tmp->mask = _size - 1;                                                   \
+    for (_tmpi = 0; _tmpi < _tmp->size; _tmpi++)                              \
+      _tmp->seq[_tmpi] = _tmpi;                                               \
+    __atomic_store_n (&_tmp->in, 0, __ATOMIC_RELAXED);                        \
+    __atomic_store_n (&_tmp->out, 0, __ATOMIC_RELEASE);                       \
+  })
+
+/**
+ * @brief return true if fifo is empty
+ *
+ * Only a snapshot, other threads may change it at any time.
+ *
+ * @param [in] _fifo: fifo's address
+ */
+#define gfifo_mpmc_empty(_fifo)                                               \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    __atomic_load_n (&_tmp->in, __ATOMIC_ACQUIRE)                             \
+        == __atomic_load_n (&_tmp->out, __ATOMIC_ACQUIRE);                    \
+  })
+
+/**
+ * @brief return number of element in fifo
+ *
+ * Only a snapshot, other threads may change it at any time.
+ *
+ * @param [in] _fifo: fifo's address
+ */
+#define gfifo_mpmc_vaild_count(_fifo)                                         \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    unsigned int _tmpout = __atomic_load_n (&_tmp->out, __ATOMIC_ACQUIRE);    \
+    unsigned int _tmpin = __atomic_load_n (&_tmp->in, __ATOMIC_ACQUIRE);      \
+    (int)(_tmpin - _tmpout) > 0 ? _tmpin - _tmpout : 0;                       \
+  })
+
+/**
+ * @brief insert an element into fifo
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _value: element's address
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed
+ */
+#define gfifo_mpmc_insert(_fifo, _value, _type)                               \
+  (unsigned int)({                                                            \
+    unsigned int _ret = 0;                                                    \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_value + 1) _tmpv = _value;                                       \
+    unsigned int _tmppos = __atomic_load_n (&_tmp->in, __ATOMIC_RELAXED);     \
+    for (;;)                                                                  \
+      {                                                                       \
+        unsigned int _tmpseq = __atomic_load_n (                              \
+            &_tmp->seq[_tmppos & _tmp->mask], __ATOMIC_ACQUIRE);              \
+        int _tmpdiff = (int)(_tmpseq - _tmppos);                              \
+        if (_tmpdiff == 0)                                                    \
+          {                                                                   \
+            if (__atomic_compare_exchange_n (&_tmp->in, &_tmppos,             \
+                                             _tmppos + 1, 1,                  \
+                                             __ATOMIC_RELAXED,                \
+                                             __ATOMIC_RELAXED))               \
+              {                                                               \
+                _ret = 1;                                                     \
+                break;                                                        \
+              }                                                               \
+          }                                                                   \
+        else if (_tmpdiff < 0)                                                \
+          break;                                                              \
+        else                                                                  \
+          _tmppos = __atomic_load_n (&_tmp->in, __ATOMIC_RELAXED);            \
+      }                                                                       \
+    if (_ret)                                                                 \
+      {                                                                       \
+        memcpy ((_type *)_tmp->data + (_tmppos & _tmp->mask), _tmpv,          \
+                sizeof (_type));                                              \
+        __atomic_store_n (&_tmp->seq[_tmppos & _tmp->mask], _tmppos + 1,      \
+                          __ATOMIC_RELEASE);                                  \
+      }                                                                       \
+    _ret;                                                                     \
+  })
+
+/**
+ * @brief remove an element from fifo
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _value: element's address
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed
+ */
+#define gfifo_mpmc_remove(_fifo, _value, _type)                               \
+  (unsigned int)({                                                            \
+    unsigned int _ret = 0;                                                    \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_value + 1) _tmpv = _value;                                       \
+    unsigned int _tmppos = __atomic_load_n (&_tmp->out, __ATOMIC_RELAXED);    \
+    for (;;)                                                                  \
+      {                                                                       \
+        unsigned int _tmpseq = __atomic_load_n (                              \
+            &_tmp->seq[_tmppos & _tmp->mask], __ATOMIC_ACQUIRE);              \
+        int _tmpdiff = (int)(_tmpseq - (_tmppos + 1));                        \
+        if (_tmpdiff == 0)                                                    \
+          {                                                                   \
+            if (__atomic_compare_exchange_n (&_tmp->out, &_tmppos,            \
+                                             _tmppos + 1, 1,                  \
+                                             __ATOMIC_RELAXED,                \
+                                             __ATOMIC_RELAXED))               \
+              {                                                               \
+                _ret = 1;                                                     \
+                break;                                                        \
+              }                                                               \
+          }                                                                   \
+        else if (_tmpdiff < 0)                                                \
+          break;                                                              \
+        else                                                                  \
+          _tmppos = __atomic_load_n (&_tmp->out, __ATOMIC_RELAXED);           \
+      }                                                                       \
+    if (_ret)                                                                 \
+      {                                                                       \
+        memcpy (_tmpv, (_type *)_tmp->data + (_tmppos & _tmp->mask),          \
+                sizeof (_type));                                              \
+        __atomic_store_n (&_tmp->seq[_tmppos & _tmp->mask],                   \
+                          _tmppos + _tmp->mask + 1, __ATOMIC_RELEASE);        \
+      }                                                                       \
+    _ret;                                                                     \
+  })
+
+#endif /* __GFIFO_MPMC_H__ */
@@ -0,0 +1,316 @@
+/**
+ * @file gfifo_nt.h
+ * @brief Cache bypassing batched transfers for large fifos
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * gfifo_insert_array_nt copies big batches into the fifo with non-temporal
+ * (streaming) stores, so a producer filling a multi-megabyte ring for a
+ * consumer on another core or socket does not evict its own working set
+ * with data it never reads again. gfifo_remove_array_nt copies out with a
+ * plain memcpy, since the consumer is about to use the data, and then
+ * prefetches the elements that follow so the next batch is already on its
+ * way from memory.
+ *
+ * The copy kernel is picked once at runtime: AVX-512, AVX2 or SSE2 on x86,
+ * NEON on AArch64 (always present there), plain memcpy elsewhere. Batches
+ * smaller than GFIFO_NT_THRESHOLD bytes always use memcpy, since streaming
+ * stores only pay off once the data would not stay in cache anyway.
+ * With GFIFO_RELAXED_SLOTS, whose slot copies have to be atomic words,
+ * gfifo_insert_array_nt is plain gfifo_insert_array.
+ */
+
+#ifndef __GFIFO_NT_H__
+#define __GFIFO_NT_H__
+
+#include "gfifo.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#ifndef GFIFO_NT_THRESHOLD
+#define GFIFO_NT_THRESHOLD (64UL << 10)
+#endif
+
+#ifndef GFIFO_NT_PREFETCH_MAX
+#define GFIFO_NT_PREFETCH_MAX (16UL << 10)
+#endif
+
+typedef void (*__gfifo_nt_fn) (void *, const void *, size_t);
+
+static inline void
+__gfifo_nt_plain (void *dst, const void *src, size_t n)
+{
+  memcpy (dst, src, n);
+}
+
+/* copy up to the first _align boundary of dst, return the bytes left */
+static inline size_t
+__gfifo_nt_head (unsigned char **dst, const unsigned char **src, size_t n,
+                 size_t align)
+{
+  size_t head = -(uintptr_t)*dst & (align - 1);
+
+  if (head > n)
+    head = n;
+  memcpy (*dst, *src, head);
+  *dst += head;
+  *src += head;
+  return n - head;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__ ((target ("sse2"))) static inline void
+__gfifo_nt_sse2 (void *dst, const void *src, size_t n)
+{
+  unsigned char *d = (unsigned char *)dst;
+  const unsigned char *s = (const unsigned char *)src;
+
+  n = __gfifo_nt_head (&d, &s, n, 16);
+  for (; n >= 64; n -= 64, d += 64, s += 64)
+    {
+      __m128i a = _mm_loadu_si128 ((const __m128i *)s);
+      __m128i b = _mm_loadu_si128 ((const __m128i *)s + 1);
+      __m128i c = _mm_loadu_si128 ((const __m128i *)s + 2);
+      __m128i e = _mm_loadu_si128 ((const __m128i *)s + 3);
+      _mm_stream_si128 ((__m128i *)d, a);
+      _mm_stream_si128 ((__m128i *)d + 1, b);
+      _mm_stream_si128 ((__m128i *)d + 2, c);
+      _mm_stream_si128 ((__m128i *)d + 3, e);
+    }
+  memcpy (d, s, n);
+}
+
+__attribute__ ((target ("avx2"))) static inline void
+__gfifo_nt_avx2 (void *dst, const void *src, size_t n)
+{
+  unsigned char *d = (unsigned char *)dst;
+  const unsigned char *s = (const unsigned char *)src;
+
+  n = __gfifo_nt_head (&d, &s, n, 32);
+  for (; n >= 128; n -= 128, d += 128, s += 128)
+    {
+      __m256i a = _mm256_loadu_si256 ((const __m256i *)s);
+      __m256i b = _mm256_loadu_si256 ((const __m256i *)s + 1);
+      __m256i c = _mm256_loadu_si256 ((const __m256i *)s + 2);
+      __m256i e = _mm256_loadu_si256 ((const __m256i *)s + 3);
+      _mm256_stream_si256 ((__m256i *)d, a);
+      _mm256_stream_si256 ((__m256i *)d + 1, b);
+      _mm256_stream_si256 ((__m256i *)d + 2, c);
+      _mm256_stream_si256 ((__m256i *)d + 3, e);
+    }
+  memcpy (d, s, n);
+}
+
+__attribute__ ((target ("avx512f"))) static inline void
+__gfifo_nt_avx512 (void *dst, const void *src, size_t n)
+{
+  unsigned char *d = (unsigned char *)dst;
+  const unsigned char *s = (const unsigned char *)src;
+
+  n = __gfifo_nt_head (&d, &s, n, 64);
+  for (; n >= 256; n -= 256, d += 256, s += 256)
+    {
+      __m512i a = _mm512_loadu_si512 ((const void *)s);
+      __m512i b = _mm512_loadu_si512 ((const void *)(s + 64));
+      __m512i c = _mm512_loadu_si512 ((const void *)(s + 128));
+      __m512i e = _mm512_loadu_si512 ((const void *)(s + 192));
+      _mm512_stream_si512 ((__m512i *)d, a);
+      _mm512_stream_si512 ((__m512i *)(d + 64), b);
+      _mm512_stream_si512 ((__m512i *)(d + 128), c);
+      _mm512_stream_si512 ((__m512i *)(d + 192), e);
+    }
+  memcpy (d, s, n);
+}
+
+/* streaming stores are weakly ordered, drain them before publishing */
+#define __gfifo_nt_fence() _mm_sfence ()
+
+static inline __gfifo_nt_fn
+__gfifo_nt_detect (void)
+{
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx512f"))
+    return __gfifo_nt_avx512;
+  if (__builtin_cpu_supports ("avx2"))
+    return __gfifo_nt_avx2;
+  if (__builtin_cpu_supports ("sse2"))
+    return __gfifo_nt_sse2;
+  return __gfifo_nt_plain;
+}
+#elif defined(__aarch64__)
+static inline void
+__gfifo_nt_neon (void *dst, const void *src, size_t n)
+{
+  unsigned char *d = (unsigned char *)dst;
+  const unsigned char *s = (const unsigned char *)src;
+
+  n = __gfifo_nt_head (&d, &s, n, 64);
+  for (; n >= 64; n -= 64, d += 64, s += 64)
+    __asm__ volatile ("ldp q0, q1, [%1]\n\t"
+                      "ldp q2, q3, [%1, #32]\n\t"
+                      "stnp q0, q1, [%0]\n\t"
+                      "stnp q2, q3, [%0, #32]"
+                      :
+                      : "r"(d), "r"(s)
+                      : "v0", "v1", "v2", "v3", "memory");
+  memcpy (d, s, n);
+}
+
+#define __gfifo_nt_fence() __asm__ volatile ("dmb ishst" ::: "memory")
+
+static inline __gfifo_nt_fn
+__gfifo_nt_detect (void)
+{
+  return __gfifo_nt_neon;
+}
+#else
+#define __gfifo_nt_fence() ((void)0)
+
+static inline __gfifo_nt_fn
+__gfifo_nt_detect (void)
+{
+  return __gfifo_nt_plain;
+}
+#endif
+
+/**
+ * @brief copy with non-temporal stores, using the best kernel of this CPU
+ *
+ * Does not order the stores, __gfifo_nt_fence must follow before the data
+ * is published to another thread.
+ *
+ * @param[out] dst: destination's address
+ * @param[in] src: source's address
+ * @param[in] n: number of bytes
+ */
+static inline void
+gfifo_nt_memcpy (void *dst, const void *src, size_t n)
+{
+  static __gfifo_nt_fn fn;
+  __gfifo_nt_fn f = __atomic_load_n (&fn, __ATOMIC_RELAXED);
+
+  if (__builtin_expect (!f, 0))
+    {
+      f = __gfifo_nt_detect ();
+      __atomic_store_n (&fn, f, __ATOMIC_RELAXED);
+    }
+  f (dst, src, n);
+}
+
+/* read prefetch up to GFIFO_NT_PREFETCH_MAX of n bytes at p */
+static inline void
+__gfifo_nt_prefetch (const void *p, size_t n)
+{
+  const unsigned char *c = (const unsigned char *)p;
+  size_t i;
+
+  if (n > GFIFO_NT_PREFETCH_MAX)
+    n = GFIFO_NT_PREFETCH_MAX;
+  for (i = 0; i < n; i += GFIFO_CACHELINE_SIZE)
+    __builtin_prefetch (c + i, 0, 3);
+}
+
+/**
+ * @brief insert number of element into fifo, bypassing the cache
+ *
+ * Same as gfifo_insert_array, but batches of at least GFIFO_NT_THRESHOLD
+ * bytes are written with non-temporal stores.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [in] _array: elements' address
+ * @param [in] _len: number of elements
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed
+ */
+#define gfifo_insert_array_nt(_fifo, _array, _len, _type)                     \
+  (unsigned int)({                                                            \
+    unsigned int _ret;                                                        \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_array + 1) _tmparr = _array;                                     \
+    unsigned int _tmplen = _len;                                              \
+    unsigned int _tmpin = _tmp->in;                                           \
+    unsigned int _tmpoff = __gfifo_idx (_tmp, _tmpin);                        \
+    _ret = __gfifo_stat_room (                                                \
+        _tmp, __gfifo_prod_space (_tmp, _tmplen) >= _tmplen);                 \
+    if (_ret && sizeof (_type) * _tmplen < GFIFO_NT_THRESHOLD)                \
+      __gfifo_copy_in (_tmp, _tmpoff, _tmparr, _tmplen, _type);               \
+    else if (_ret)                                                            \
+      {                                                                       \
+        unsigned int _tmpfirst = __gfifo_first_run (_tmp, _tmpoff, _tmplen);  \
+        gfifo_nt_memcpy ((_type *)__gfifo_data (_tmp) + _tmpoff, _tmparr,     \
+                         sizeof (_type) * _tmpfirst);                         \
+        gfifo_nt_memcpy (__gfifo_data (_tmp), _tmparr + _tmpfirst,            \
+                         sizeof (_type) * (_tmplen - _tmpfirst));             \
+        __gfifo_nt_fence ();                                                  \
+      }                                                                       \
+    if (_ret)                                                                 \
+      __gfifo_publish_in (_tmp, __gfifo_next (_tmp, _tmpin, _tmplen));        \
+    _ret;                                                                     \
+  })
+
+/**
+ * @brief remove number of element from fifo, prefetching the next ones
+ *
+ * Same as gfifo_remove_array, then issues read prefetches for the elements
+ * already in the fifo after the removed ones, at most @c _len of them.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [out] _array: elements' address
+ * @param [in] _len: number of elements
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed
+ */
+#define gfifo_remove_array_nt(_fifo, _array, _len, _type)                     \
+  (unsigned int)({                                                            \
+    unsigned int _ret;                                                        \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_array + 1) _tmparr = _array;                                     \
+    unsigned int _tmplen = _len;                                              \
+    unsigned int _tmpout = _tmp->out;                                         \
+    unsigned int _tmpcnt = __gfifo_cons_count (_tmp, _tmplen);                \
+    _ret = __gfifo_stat_avail (_tmp, _tmpcnt >= _tmplen);                     \
+    if (_ret)                                                                 \
+      {                                                                       \
+        unsigned int _tmpnext = __gfifo_next (_tmp, _tmpout, _tmplen);        \
+        unsigned int _tmpoff = __gfifo_idx (_tmp, _tmpnext);                  \
+        unsigned int _tmppf = _tmpcnt - _tmplen;                              \
+        unsigned int _tmpfirst;                                               \
+        __gfifo_copy_out (_tmp, __gfifo_idx (_tmp, _tmpout), _tmparr,         \
+                          _tmplen, _type);                                    \
+        __gfifo_publish_out (_tmp, _tmpnext);                                 \
+        if (_tmppf > _tmplen)                                                 \
+          _tmppf = _tmplen;                                                   \
+        _tmpfirst = __gfifo_first_run (_tmp, _tmpoff, _tmppf);                \
+        __gfifo_nt_prefetch ((_type *)__gfifo_data (_tmp) + _tmpoff,          \
+                             sizeof (_type) * _tmpfirst);                     \
+        __gfifo_nt_prefetch (__gfifo_data (_tmp),                             \
+                             sizeof (_type) * (_tmppf - _tmpfirst));          \
+      }                                                                       \
+    _ret;                                                                     \
+  })
+
+#ifdef GFIFO_RELAXED_SLOTS
+#undef gfifo_insert_array_nt
+#define gfifo_insert_array_nt(_fifo, _array, _len, _type)                     \
+  gfifo_insert_array (_fifo, _array, _len, _type)
+#endif
+
+#ifdef GFIFO_OVERWRITE
+#undef gfifo_remove_array_nt
+#define gfifo_remove_array_nt(...)                                            \
+  __gfifo_overwrite_unsafe (gfifo_remove_array_nt)
+#endif
+
+#endif /* __GFIFO_NT_H__ */
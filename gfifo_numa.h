@@ -0,0 +1,311 @@
+/**
+ * @file gfifo_numa.h
+ * @brief NUMA placed fifo buffers and thread pinning
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * A buffer from malloc ends up on whichever node first touches it, often
+ * the producer's or the initialising thread's, not the consumer's.
+ * gfifo_numa_alloc maps the buffer, binds it to the chosen node with
+ * mbind before any page is touched, optionally backs it with hugepages,
+ * and pre-faults every page so the fast path never takes a page fault.
+ *
+ * struct gfifo_numa also records the intended producer and consumer CPUs;
+ * gfifo_numa_remote then tells which side would reach the buffer across
+ * nodes, and gfifo_numa_pin puts a thread where it was planned to run.
+ *
+ * Linux only, uses the mbind and get_mempolicy system calls directly, so
+ * no libnuma is needed. Build with _GNU_SOURCE defined.
+ */
+
+#ifndef __GFIFO_NUMA_H__
+#define __GFIFO_NUMA_H__
+
+#include "gfifo.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef GFIFO_NUMA_HUGE_SIZE
+#define GFIFO_NUMA_HUGE_SIZE (2UL << 20)
+#endif
+
+/* highest node number + 1 that gfifo_numa_alloc can bind to */
+#define GFIFO_NUMA_MAX_NODES 1024
+
+/* gfifo_numa_alloc flags */
+#define GFIFO_NUMA_HUGE 1 /* hugetlbfs pages, else transparent hugepages */
+
+/* struct gfifo_numa huge values */
+#define GFIFO_NUMA_HUGE_NONE 0
+#define GFIFO_NUMA_HUGE_TLB 1
+#define GFIFO_NUMA_HUGE_THP 2
+
+/* gfifo_numa_remote bits */
+#define GFIFO_NUMA_REMOTE_PROD 1
+#define GFIFO_NUMA_REMOTE_CONS 2
+
+/**
+ * @brief NUMA placement of a fifo buffer
+ */
+struct gfifo_numa
+{
+  void *buf;
+  size_t map_size;
+  int node;           /* node holding buf, -1 if unknown */
+  int prod_cpu;       /* intended producer CPU, -1 if unset */
+  int cons_cpu;       /* intended consumer CPU, -1 if unset */
+  unsigned int huge;  /* GFIFO_NUMA_HUGE_* */
+};
+
+/**
+ * @brief return the node a CPU belongs to
+ *
+ * @param[in] cpu: CPU number
+ *
+ * @retval:
+ *    \li node number: success
+ *    \li -1: failed, unknown CPU or no NUMA information
+ */
+static inline int
+gfifo_numa_node_of_cpu (int cpu)
+{
+  char path[64];
+  struct dirent *de;
+  int node = -1;
+  DIR *dir;
+
+  snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu%d", cpu);
+  dir = opendir (path);
+  if (!dir)
+    return -1;
+  while ((de = readdir (dir)) != NULL)
+    if (sscanf (de->d_name, "node%d", &node) == 1)
+      break;
+  closedir (dir);
+  return de ? node : -1;
+}
+
+/* bind [buf, buf + len) to node, a kernel without NUMA counts as success */
+static inline int
+__gfifo_numa_bind (void *buf, size_t len, int node)
+{
+  unsigned long mask[GFIFO_NUMA_MAX_NODES / (8 * sizeof (unsigned long))]
+      = { 0 };
+
+  if (node < 0)
+    return 0;
+  if (node >= GFIFO_NUMA_MAX_NODES)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+  mask[node / (8 * sizeof (unsigned long))]
+      |= 1UL << (node % (8 * sizeof (unsigned long)));
+  if (syscall (SYS_mbind, buf, len, MPOL_BIND, mask,
+               GFIFO_NUMA_MAX_NODES + 1, MPOL_MF_MOVE)
+          < 0
+      && errno != ENOSYS)
+    return -1;
+  return 0;
+}
+
+/* node actually holding the page at buf */
+static inline int
+__gfifo_numa_node_of (void *buf)
+{
+  int node = -1;
+
+  if (syscall (SYS_get_mempolicy, &node, NULL, 0, buf,
+               MPOL_F_NODE | MPOL_F_ADDR)
+      < 0)
+    return -1;
+  return node;
+}
+
+/**
+ * @brief allocate a fifo buffer on a NUMA node
+ *
+ * @param[out] nm: placement, prod_cpu and cons_cpu are reset to -1; on
+ *                failure buf is NULL and node -1
+ * @param[in] bytes: buffer's size (i.e. @c size * sizeof (_type))
+ * @param[in] node: node to bind the buffer to, -1 to leave it local
+ * @param[in] flags: 0 or GFIFO_NUMA_HUGE
+ *
+ * @retval:
+ *    \li 0: success
+ *    \li -1: failed, errno is set
+ */
+static inline int
+gfifo_numa_alloc (struct gfifo_numa *nm, size_t bytes, int node,
+                  unsigned int flags)
+{
+  size_t page = sysconf (_SC_PAGESIZE), step = page, i;
+  void *buf = MAP_FAILED;
+  int err;
+
+  /* a failed call leaves nm safe for gfifo_numa_free */
+  nm->buf = NULL;
+  nm->node = -1;
+  nm->prod_cpu = -1;
+  nm->cons_cpu = -1;
+  nm->huge = GFIFO_NUMA_HUGE_NONE;
+  nm->map_size = (bytes + page - 1) / page * page;
+  if (flags & GFIFO_NUMA_HUGE)
+    {
+      nm->map_size = (bytes + GFIFO_NUMA_HUGE_SIZE - 1) / GFIFO_NUMA_HUGE_SIZE
+                     * GFIFO_NUMA_HUGE_SIZE;
+      buf = mmap (NULL, nm->map_size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (buf != MAP_FAILED)
+        {
+          nm->huge = GFIFO_NUMA_HUGE_TLB;
+          step = GFIFO_NUMA_HUGE_SIZE;
+        }
+    }
+  if (buf == MAP_FAILED)
+    buf = mmap (NULL, nm->map_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buf == MAP_FAILED)
+    return -1;
+  if ((flags & GFIFO_NUMA_HUGE) && nm->huge == GFIFO_NUMA_HUGE_NONE
+      && madvise (buf, nm->map_size, MADV_HUGEPAGE) == 0)
+    nm->huge = GFIFO_NUMA_HUGE_THP;
+
+  if (__gfifo_numa_bind (buf, nm->map_size, node) < 0)
+    {
+      err = errno;
+      munmap (buf, nm->map_size);
+      errno = err;
+      return -1;
+    }
+
+  /* first touch after mbind so every page is faulted in on node */
+  for (i = 0; i < nm->map_size; i += step)
+    ((volatile unsigned char *)buf)[i] = 0;
+
+  nm->buf = buf;
+  nm->node = __gfifo_numa_node_of (buf);
+  return 0;
+}
+
+/**
+ * @brief free a buffer obtained from gfifo_numa_alloc
+ *
+ * @param[inout] nm: placement
+ */
+static inline void
+gfifo_numa_free (struct gfifo_numa *nm)
+{
+  if (nm->buf)
+    munmap (nm->buf, nm->map_size);
+  nm->buf = NULL;
+}
+
+/**
+ * @brief record where the producer and the consumer are meant to run
+ *
+ * @param[inout] nm: placement
+ * @param[in] prod_cpu: producer's CPU, -1 if unknown
+ * @param[in] cons_cpu: consumer's CPU, -1 if unknown
+ */
+static inline void
+gfifo_numa_set_cpus (struct gfifo_numa *nm, int prod_cpu, int cons_cpu)
+{
+  nm->prod_cpu = prod_cpu;
+  nm->cons_cpu = cons_cpu;
+}
+
+/**
+ * @brief tell which side would access the buffer from another node
+ *
+ * @param[in] nm: placement
+ *
+ * @retval: GFIFO_NUMA_REMOTE_PROD and/or GFIFO_NUMA_REMOTE_CONS, or 0 if
+ *          both are local or the placement is unknown
+ */
+static inline unsigned int
+gfifo_numa_remote (const struct gfifo_numa *nm)
+{
+  unsigned int remote = 0;
+  int node;
+
+  if (nm->node < 0)
+    return 0;
+  node = nm->prod_cpu < 0 ? -1 : gfifo_numa_node_of_cpu (nm->prod_cpu);
+  if (node >= 0 && node != nm->node)
+    remote |= GFIFO_NUMA_REMOTE_PROD;
+  node = nm->cons_cpu < 0 ? -1 : gfifo_numa_node_of_cpu (nm->cons_cpu);
+  if (node >= 0 && node != nm->node)
+    remote |= GFIFO_NUMA_REMOTE_CONS;
+  return remote;
+}
+
+/**
+ * @brief pin the calling thread to one CPU
+ *
+ * @param[in] cpu: CPU number
+ *
+ * @retval:
+ *    \li 0: success
+ *    \li error number: failed
+ */
+static inline int
+gfifo_numa_pin (int cpu)
+{
+  cpu_set_t set;
+
+  CPU_ZERO (&set);
+  CPU_SET (cpu, &set);
+  return pthread_setaffinity_np (pthread_self (), sizeof (set), &set);
+}
+
+/**
+ * @brief allocate a buffer on the consumer's node and initialize a fifo
+ *
+ * Buffers of at least GFIFO_NUMA_HUGE_SIZE bytes ask for huge pages,
+ * smaller ones would only be rounded up to a whole one.
+ *
+ * @param[inout] _fifo: fifo's address
+ * @param[out] _nm: placement
+ * @param[in] _size: fifo's size
+ * @param[in] _prod_cpu: producer's CPU, -1 if unknown
+ * @param[in] _cons_cpu: consumer's CPU, -1 to leave the buffer local
+ * @param[in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, errno is set
+ */
+#define gfifo_numa_init(_fifo, _nm, _size, _prod_cpu, _cons_cpu, _type)       \
+  (unsigned int)({                                                            \
+    struct gfifo_numa *_tmpnm = _nm;                                          \
+    unsigned int _tmpsize = _size;                                            \
+    int _tmpcons = _cons_cpu;                                                 \
+    int _tmpnode = _tmpcons < 0 ? -1 : gfifo_numa_node_of_cpu (_tmpcons);     \
+    size_t _tmpbytes = (size_t)_tmpsize * sizeof (_type);                     \
+    unsigned int _ret                                                         \
+        = gfifo_numa_alloc (_tmpnm, _tmpbytes, _tmpnode,                      \
+                            _tmpbytes >= GFIFO_NUMA_HUGE_SIZE                 \
+                                ? GFIFO_NUMA_HUGE                             \
+                                : 0)                                          \
+          == 0;                                                               \
+    if (_ret)                                                                 \
+      {                                                                       \
+        gfifo_numa_set_cpus (_tmpnm, _prod_cpu, _tmpcons);                    \
+        gfifo_init (_fifo, _tmpnm->buf, _tmpsize);                            \
+      }                                                                       \
+    _ret;                                                                     \
+  })
+
+#endif /* __GFIFO_NUMA_H__ */
@@ -0,0 +1,213 @@
+/**
+ * @file gfifo_prio.h
+ * @brief Strict priority queue over an array of fifos
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * One struct gfifo ring per priority level, level 0 being the highest, and
+ * a bitmask with one bit per level that is set while the level may hold
+ * elements. The consumer picks the highest level with a single count of
+ * trailing zeros on the mask instead of checking every ring in turn, so a
+ * remove costs the same however many levels are empty.
+ *
+ * Each level keeps one producer and one consumer, as with GFIFO_SPSC, but
+ * different levels may have different producers. A producer sets its
+ * level's bit after publishing the element. The consumer clears a bit once
+ * it finds the level empty and then looks at the ring again, setting the
+ * bit back if an insert slipped in between, so no element is ever left
+ * behind a clear bit. A set bit over an empty ring only costs a retry.
+ *
+ * Including this file before gfifo.h enables GFIFO_SPSC.
+ */
+
+#ifndef __GFIFO_PRIO_H__
+#define __GFIFO_PRIO_H__
+
+#ifndef GFIFO_SPSC
+#ifdef __GFIFO_H__
+#error "gfifo.h included without GFIFO_SPSC, include gfifo_prio.h first"
+#endif
+#define GFIFO_SPSC
+#endif
+
+#include "gfifo.h"
+
+/* one bit per level in struct gfifo_prio */
+#define GFIFO_PRIO_MAX_LEVELS 32
+
+/**
+ * @brief Priority queue of @c nr levels
+ */
+struct gfifo_prio
+{
+  struct gfifo *rings;
+  unsigned int nr;
+
+  /* written by the producers and the consumer */
+  unsigned int mask __attribute__ ((aligned (GFIFO_CACHELINE_SIZE)));
+} __attribute__ ((aligned (GFIFO_CACHELINE_SIZE)));
+
+/**
+ * @brief Initialize a priority queue, one fifo per level sharing a buffer
+ *
+ * @param[inout] _prio: priority queue's address
+ * @param[inout] _rings: array of @c _nr struct gfifo
+ * @param[in] _nr: number of levels, at most GFIFO_PRIO_MAX_LEVELS
+ * @param[in] _buf: buffer of @c _nr * @c _size elements
+ * @param[in] _size: size of each fifo
+ * @param[in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, @c _nr is 0 or above GFIFO_PRIO_MAX_LEVELS
+ */
+#define gfifo_prio_init(_prio, _rings, _nr, _buf, _size, _type)               \
+  (unsigned int)({                                                            \
+    typeof (_prio + 1) _tmpp = _prio;                                         \
+    unsigned int _tmpnr = _nr, _tmpsize = _size, _tmpi;                       \
+    unsigned int _ret = _tmpnr && _tmpnr <= GFIFO_PRIO_MAX_LEVELS;            \
+    if (_ret)                                                                 \
+      {                                                                       \
+        _tmpp->rings = _rings;                                                \
+        _tmpp->nr = _tmpnr;                                                   \
+        for (_tmpi = 0; _tmpi < _tmpnr; _tmpi++)                              \
+          gfifo_init (&_tmpp->rings[_tmpi],                                   \
+                      (_type *)(_buf) + (unsigned long)_tmpi * _tmpsize,      \
+                      _tmpsize);                                              \
+        __atomic_store_n (&_tmpp->mask, 0, __ATOMIC_RELEASE);                 \
+      }                                                                       \
+    _ret;                                                                     \
+  })
+
+/* after the consumer saw level empty: clear its bit unless it refilled */
+#define __gfifo_prio_settle(_prio, _level)                                    \
+  ({                                                                          \
+    unsigned int _tmpbit = 1u << (_level);                                    \
+    __atomic_fetch_and (&(_prio)->mask, ~_tmpbit, __ATOMIC_ACQ_REL);          \
+    if (!gfifo_empty (&(_prio)->rings[_level]))                               \
+      __atomic_fetch_or (&(_prio)->mask, _tmpbit, __ATOMIC_RELAXED);          \
+  })
+
+/**
+ * @brief return true if every level is empty
+ *
+ * @param [in] _prio: priority queue's address
+ */
+#define gfifo_prio_empty(_prio)                                               \
+  (unsigned int)(__atomic_load_n (&(_prio)->mask, __ATOMIC_ACQUIRE) == 0)
+
+/**
+ * @brief insert an element at a priority level
+ *
+ * @param [inout] _prio: priority queue's address
+ * @param [in] _level: priority level, 0 is the highest
+ * @param [in] _value: element's address
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, the level is full or not below @c nr
+ */
+#define gfifo_prio_insert(_prio, _level, _value, _type)                       \
+  (unsigned int)({                                                            \
+    typeof (_prio + 1) _tmpp = _prio;                                         \
+    unsigned int _tmplvl = _level;                                            \
+    unsigned int _ret                                                         \
+        = _tmplvl < _tmpp->nr                                                 \
+          && gfifo_insert (&_tmpp->rings[_tmplvl], _value, _type);            \
+    /* release: a consumer that sees the bit also sees the element */         \
+    if (_ret)                                                                 \
+      __atomic_fetch_or (&_tmpp->mask, 1u << _tmplvl, __ATOMIC_RELEASE);      \
+    _ret;                                                                     \
+  })
+
+/**
+ * @brief insert number of element at a priority level
+ *
+ * @param [inout] _prio: priority queue's address
+ * @param [in] _level: priority level, 0 is the highest
+ * @param [in] _array: elements' address
+ * @param [in] _len: number of elements
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, not enough room at the level or not below @c nr
+ */
+#define gfifo_prio_insert_array(_prio, _level, _array, _len, _type)           \
+  (unsigned int)({                                                            \
+    typeof (_prio + 1) _tmpp = _prio;                                         \
+    unsigned int _tmplvl = _level;                                            \
+    unsigned int _ret                                                         \
+        = _tmplvl < _tmpp->nr                                                 \
+          && gfifo_insert_array (&_tmpp->rings[_tmplvl], _array, _len,        \
+                                 _type);                                      \
+    if (_ret)                                                                 \
+      __atomic_fetch_or (&_tmpp->mask, 1u << _tmplvl, __ATOMIC_RELEASE);      \
+    _ret;                                                                     \
+  })
+
+/**
+ * @brief remove the oldest element of the highest non-empty level
+ *
+ * @param [inout] _prio: priority queue's address
+ * @param [out] _value: element's address
+ * @param [in] _type: element's type
+ *
+ * @retval:
+ *    \li level + 1: success, the element came from level
+ *    \li 0: failed, every level is empty
+ */
+#define gfifo_prio_remove(_prio, _value, _type)                               \
+  (unsigned int)({                                                            \
+    typeof (_prio + 1) _tmpp = _prio;                                         \
+    typeof (_value + 1) _tmpval = _value;                                     \
+    unsigned int _tmpm, _tmplvl, _ret = 0;                                    \
+    while ((_tmpm = __atomic_load_n (&_tmpp->mask, __ATOMIC_ACQUIRE)) != 0)   \
+      {                                                                       \
+        _tmplvl = __builtin_ctz (_tmpm);                                      \
+        if (gfifo_remove (&_tmpp->rings[_tmplvl], _tmpval, _type))            \
+          {                                                                   \
+            if (gfifo_empty (&_tmpp->rings[_tmplvl]))                         \
+              __gfifo_prio_settle (_tmpp, _tmplvl);                           \
+            _ret = _tmplvl + 1;                                               \
+            break;                                                            \
+          }                                                                   \
+        __gfifo_prio_settle (_tmpp, _tmplvl);                                 \
+      }                                                                       \
+    _ret;                                                                     \
+  })
+
+/**
+ * @brief remove up to number of element from the highest non-empty level
+ *
+ * Elements of lower levels are left alone even if @c _len is not reached,
+ * so one call never mixes priorities.
+ *
+ * @param [inout] _prio: priority queue's address
+ * @param [out] _array: elements' address
+ * @param [in] _len: maximum number of elements
+ * @param [in] _type: element's type
+ *
+ * @retval: number of elements removed
+ */
+#define gfifo_prio_remove_upto(_prio, _array, _len, _type)                    \
+  (unsigned int)({                                                            \
+    typeof (_prio + 1) _tmpp = _prio;                                         \
+    typeof (_array + 1) _tmpdst = _array;                                     \
+    unsigned int _tmpmax = _len, _tmpm, _tmplvl, _tmpgot = 0;                 \
+    while ((_tmpm = __atomic_load_n (&_tmpp->mask, __ATOMIC_ACQUIRE)) != 0)   \
+      {                                                                       \
+        _tmplvl = __builtin_ctz (_tmpm);                                      \
+        _tmpgot = gfifo_remove_upto (&_tmpp->rings[_tmplvl], _tmpdst,         \
+                                     _tmpmax, _type);                         \
+        if (!_tmpgot || gfifo_empty (&_tmpp->rings[_tmplvl]))                 \
+          __gfifo_prio_settle (_tmpp, _tmplvl);                               \
+        if (_tmpgot)                                                          \
+          break;                                                              \
+      }                                                                       \
+    _tmpgot;                                                                  \
+  })
+
+#endif /* __GFIFO_PRIO_H__ */
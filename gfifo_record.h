@@ -0,0 +1,168 @@
+/**
+ * @file gfifo_record.h
+ * @brief Variable length records on top of a byte fifo
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * Instead of fixed @c _type slots, the fifo's buffer is treated as bytes and
+ * every record takes only its own length: an unsigned int length header,
+ * the payload, and padding up to GFIFO_RECORD_ALIGN. A record is never
+ * split at the end of the buffer; when it does not fit there, the producer
+ * writes a skip marker and continues at offset 0, and the consumer jumps
+ * over the marker. With GFIFO_MIRRORED the buffer end is not a boundary,
+ * so no space is skipped at all.
+ *
+ * Set the fifo up with gfifo_init on a buffer of @c size bytes (a power of
+ * two, or with GFIFO_ANY_SIZE a multiple of GFIFO_RECORD_ALIGN) aligned to
+ * GFIFO_RECORD_ALIGN. A record of @c len bytes needs
+ * gfifo_record_size (@c len) bytes of free space, plus the skipped tail
+ * when it wraps; keep records well below half the buffer size.
+ *
+ * All the gfifo.h modes apply, with GFIFO_SPSC one producer thread and one
+ * consumer thread may use the records concurrently. With GFIFO_STATS the
+ * counters count records and their bytes, without the tail skipped at the
+ * wrap, on both sides.
+ */
+
+#ifndef __GFIFO_RECORD_H__
+#define __GFIFO_RECORD_H__
+
+#include "gfifo.h"
+
+#ifdef GFIFO_OVERWRITE
+#error "records cannot be overwritten in place, build without GFIFO_OVERWRITE"
+#endif
+
+#ifdef GFIFO_TIMESTAMP
+#error "GFIFO_TIMESTAMP would stamp every byte of a record, build without it"
+#endif
+
+#ifndef GFIFO_RECORD_ALIGN
+#define GFIFO_RECORD_ALIGN 8
+#endif
+
+#if GFIFO_RECORD_ALIGN < 4 || (GFIFO_RECORD_ALIGN & (GFIFO_RECORD_ALIGN - 1))
+#error "GFIFO_RECORD_ALIGN must be a power of two of at least 4"
+#endif
+
+/* length header value marking the unused tail before the wrap */
+#define GFIFO_RECORD_SKIP 0xffffffffu
+
+/**
+ * @brief return the number of fifo bytes a record of len bytes occupies
+ *
+ * @param[in] len: payload's length
+ */
+static inline unsigned int
+gfifo_record_size (unsigned int len)
+{
+  return (sizeof (unsigned int) + len + GFIFO_RECORD_ALIGN - 1)
+         & ~(GFIFO_RECORD_ALIGN - 1);
+}
+
+/**
+ * @brief insert a record into fifo
+ *
+ * @param[inout] fifo: fifo's address
+ * @param[in] buf: payload's address
+ * @param[in] len: payload's length
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, not enough free space
+ */
+static inline unsigned int
+gfifo_push_record (struct gfifo *fifo, const void *buf, unsigned int len)
+{
+  unsigned char *data = (unsigned char *)__gfifo_data (fifo);
+  unsigned int in = fifo->in;
+  unsigned int off = __gfifo_idx (fifo, in);
+  unsigned int total = gfifo_record_size (len);
+  unsigned int need = total;
+#ifndef GFIFO_MIRRORED
+  unsigned int tail = fifo->size - off;
+
+  if (total > tail)
+    need += tail;
+#endif
+
+  if (len >= GFIFO_RECORD_SKIP - 2 * GFIFO_RECORD_ALIGN
+      || __gfifo_prod_space (fifo, need) < need)
+    return 0;
+
+#ifndef GFIFO_MIRRORED
+  if (total > tail)
+    {
+      unsigned int skip = GFIFO_RECORD_SKIP;
+
+      memcpy (data + off, &skip, sizeof (skip));
+      off = 0;
+    }
+#endif
+
+  memcpy (data + off, &len, sizeof (len));
+  memcpy (data + off + sizeof (len), buf, len);
+  /* the stats count the record, not the tail it skipped */
+  __gfifo_stat_produce (fifo, total);
+  __gfifo_advance_in (fifo, __gfifo_next (fifo, in, need));
+  return 1;
+}
+
+/**
+ * @brief get the oldest record without removing it
+ *
+ * The payload is returned in place and stays valid until gfifo_pop_record.
+ *
+ * @param[inout] fifo: fifo's address
+ * @param[out] len: payload's length
+ *
+ * @retval:
+ *    \li payload's address: success
+ *    \li NULL: failed, fifo is empty
+ */
+static inline const void *
+gfifo_peek_record (struct gfifo *fifo, unsigned int *len)
+{
+  unsigned char *data = (unsigned char *)__gfifo_data (fifo);
+  unsigned int out, off, hdr;
+
+  for (;;)
+    {
+      if (__gfifo_cons_count (fifo, sizeof (hdr)) < sizeof (hdr))
+        return NULL;
+      out = fifo->out;
+      off = __gfifo_idx (fifo, out);
+      memcpy (&hdr, data + off, sizeof (hdr));
+      if (hdr != GFIFO_RECORD_SKIP)
+        break;
+      /* the record itself was published together with its skip marker */
+      __gfifo_advance_out (fifo, __gfifo_next (fifo, out, fifo->size - off));
+    }
+
+  *len = hdr;
+  return data + off + sizeof (hdr);
+}
+
+/**
+ * @brief remove the oldest record
+ *
+ * @param[inout] fifo: fifo's address
+ *
+ * @retval:
+ *    \li 1: success
+ *    \li 0: failed, fifo is empty
+ */
+static inline unsigned int
+gfifo_pop_record (struct gfifo *fifo)
+{
+  unsigned int len, total;
+
+  if (!gfifo_peek_record (fifo, &len))
+    return 0;
+  total = gfifo_record_size (len);
+  __gfifo_publish_out (fifo, __gfifo_next (fifo, fifo->out, total));
+  return 1;
+}
+
+#endif /* __GFIFO_RECORD_H__ */
@@ -0,0 +1,193 @@
+/**
+ * @file gfifo_shard.h
+ * @brief Per-CPU fifo array with work stealing consumers
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * An array of @c nr struct gfifo rings, one per CPU (or per producer).
+ * Each ring has exactly one producer, which inserts with the usual
+ * gfifo_insert / gfifo_insert_array macros. Consumers call
+ * gfifo_shard_remove_upto with their home ring: it drains the home ring
+ * first, and when that is empty steals half of the first non-empty
+ * neighbour's elements in one bulk transfer, so a consumer that falls
+ * behind is helped by the idle ones instead of letting its ring fill up.
+ *
+ * Stealing takes the oldest elements, at @c out, the only end a consumer
+ * may touch without stopping the producer, so each ring stays FIFO.
+ * Several consumers may thus remove from one ring: all of them have to go
+ * through gfifo_claim_upto or gfifo_shard_remove_upto, which claim their
+ * elements with a compare-and-swap on @c out.
+ *
+ * Including this file before gfifo.h enables GFIFO_SPSC, GFIFO_FREE_RUNNING
+ * and GFIFO_RELAXED_SLOTS. The second keeps @c out from coming back to a
+ * value a stalled consumer still expects, the third makes the copy that a
+ * consumer losing the compare-and-swap takes of slots the producer already
+ * refills a relaxed atomic one instead of a data race. With
+ * GFIFO_CACHE_ALIGNED every ring also sits on its own cache lines.
+ */
+
+#ifndef __GFIFO_SHARD_H__
+#define __GFIFO_SHARD_H__
+
+#if !defined(GFIFO_SPSC) || !defined(GFIFO_FREE_RUNNING)                      \
+    || !defined(GFIFO_RELAXED_SLOTS)
+#ifdef __GFIFO_H__
+#error "gfifo.h included without the shard modes, include gfifo_shard.h first"
+#endif
+#endif
+
+#ifndef GFIFO_SPSC
+#define GFIFO_SPSC
+#endif
+
+#ifndef GFIFO_FREE_RUNNING
+#define GFIFO_FREE_RUNNING
+#endif
+
+#ifndef GFIFO_RELAXED_SLOTS
+#define GFIFO_RELAXED_SLOTS
+#endif
+
+#include "gfifo.h"
+
+#ifdef GFIFO_ANY_SIZE
+#error "gfifo_claim_upto needs 32 bit free running indices, not GFIFO_ANY_SIZE"
+#endif
+
+#ifdef GFIFO_OVERWRITE
+#error "gfifo_claim_upto reads slots the producer may overwrite"
+#endif
+
+#ifdef GFIFO_TIMESTAMP
+#error "gfifo_claim_upto bypasses the single consumer latency histogram"
+#endif
+
+#ifdef GFIFO_STATS
+#error "gfifo_claim_upto bypasses the single consumer statistics counters"
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/**
+ * @brief Initialize an array of fifos sharing one buffer
+ *
+ * @param[inout] _rings: array of @c _nr struct gfifo
+ * @param[in] _nr: number of fifos
+ * @param[in] _buf: buffer of @c _nr * @c _size elements
+ * @param[in] _size: size of each fifo
+ * @param[in] _type: element's type
+ */
+#define gfifo_shard_init(_rings, _nr, _buf, _size, _type)                     \
+  ({                                                                          \
+    typeof (_rings + 1) _tmprings = _rings;                                   \
+    unsigned int _tmpnr = _nr, _tmpsize = _size, _tmpi;                       \
+    for (_tmpi = 0; _tmpi < _tmpnr; _tmpi++)                                  \
+      gfifo_init (&_tmprings[_tmpi],                                          \
+                  (_type *)(_buf) + (unsigned long)_tmpi * _tmpsize,          \
+                  _tmpsize);                                                  \
+  })
+
+/**
+ * @brief return the calling CPU's home fifo index
+ *
+ * @param[in] nr: number of fifos
+ */
+static inline unsigned int
+gfifo_shard_cpu (unsigned int nr)
+{
+#ifdef __linux__
+  int cpu = sched_getcpu ();
+
+  return cpu < 0 ? 0 : (unsigned int)cpu % nr;
+#else
+  (void)nr;
+  return 0;
+#endif
+}
+
+/**
+ * @brief remove up to number of element from a fifo with several consumers
+ *
+ * Like gfifo_remove_upto, but the elements are claimed with a
+ * compare-and-swap on @c out, so any number of consumers may call it on
+ * the same fifo. Copies that lose the race are discarded and retried;
+ * GFIFO_RELAXED_SLOTS makes them relaxed atomic word copies, so one racing
+ * the producer's refill of those slots is harmless.
+ *
+ * @param [inout] _fifo: fifo's address
+ * @param [out] _array: elements' address
+ * @param [in] _len: maximum number of elements
+ * @param [in] _type: element's type
+ *
+ * @retval: number of elements removed
+ */
+#define gfifo_claim_upto(_fifo, _array, _len, _type)                          \
+  (unsigned int)({                                                            \
+    typeof (_fifo + 1) _tmp = _fifo;                                          \
+    typeof (_array + 1) _tmparr = _array;                                     \
+    unsigned int _tmplen = _len;                                              \
+    unsigned int _tmpout = __atomic_load_n (&_tmp->out, __ATOMIC_ACQUIRE);    \
+    unsigned int _tmpcnt;                                                     \
+    for (;;)                                                                  \
+      {                                                                       \
+        _tmpcnt = __atomic_load_n (&_tmp->in, __ATOMIC_ACQUIRE) - _tmpout;    \
+        if (_tmpcnt > _tmplen)                                                \
+          _tmpcnt = _tmplen;                                                  \
+        if (!_tmpcnt)                                                         \
+          break;                                                              \
+        __gfifo_copy_out (_tmp, __gfifo_idx (_tmp, _tmpout), _tmparr,         \
+                          _tmpcnt, _type);                                    \
+        if (__atomic_compare_exchange_n (&_tmp->out, &_tmpout,                \
+                                         _tmpout + _tmpcnt, 0,                \
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) \
+          break;                                                              \
+        /* another consumer took them first, _tmpout is the new oldest */     \
+      }                                                                       \
+    if (_tmpcnt)                                                              \
+      __gfifo_wake (_tmp->out, _tmp->prod_waiting);                           \
+    _tmpcnt;                                                                  \
+  })
+
+/**
+ * @brief remove up to number of element, stealing when the home fifo is empty
+ *
+ * Drains fifo @c _home first. If it is empty, visits the other fifos in
+ * order starting after @c _home and takes half of the first non-empty
+ * one's elements (at most @c _len).
+ *
+ * @param [inout] _rings: array of @c _nr struct gfifo
+ * @param [in] _nr: number of fifos
+ * @param [in] _home: index of the caller's own fifo
+ * @param [out] _array: elements' address
+ * @param [in] _len: maximum number of elements
+ * @param [in] _type: element's type
+ *
+ * @retval: number of elements removed
+ */
+#define gfifo_shard_remove_upto(_rings, _nr, _home, _array, _len, _type)      \
+  (unsigned int)({                                                            \
+    typeof (_rings + 1) _tmprings = _rings;                                   \
+    typeof (_array + 1) _tmpdst = _array;                                     \
+    unsigned int _tmpnr = _nr, _tmphome = _home, _tmpmax = _len;              \
+    unsigned int _tmpi, _tmpvic = _tmphome, _tmpgot;                          \
+    _tmpgot = gfifo_claim_upto (&_tmprings[_tmphome], _tmpdst, _tmpmax,       \
+                                _type);                                       \
+    for (_tmpi = 1; !_tmpgot && _tmpi < _tmpnr; _tmpi++)                      \
+      {                                                                       \
+        unsigned int _tmphalf;                                                \
+        if (++_tmpvic == _tmpnr)                                              \
+          _tmpvic = 0;                                                        \
+        _tmphalf = (gfifo_vaild_count (&_tmprings[_tmpvic]) + 1) / 2;         \
+        if (_tmphalf > _tmpmax)                                               \
+          _tmphalf = _tmpmax;                                                 \
+        if (_tmphalf)                                                         \
+          _tmpgot = gfifo_claim_upto (&_tmprings[_tmpvic], _tmpdst, _tmphalf, \
+                                      _type);                                 \
+      }                                                                       \
+    _tmpgot;                                                                  \
+  })
+
+#endif /* __GFIFO_SHARD_H__ */
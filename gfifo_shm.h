@@ -0,0 +1,254 @@
+/**
+ * @file gfifo_shm.h
+ * @brief Inter-process fifo in POSIX shared memory
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * gfifo_shm_create places a struct gfifo and its buffer in one shm_open
+ * segment; gfifo_shm_attach maps the same segment by name in another
+ * process. The fifo is built with GFIFO_SELF_RELATIVE, so it holds no
+ * pointer and works at any mapping address, and with GFIFO_SPSC, so one
+ * producer process and one consumer process exchange elements through the
+ * usual gfifo_* macros, zero-copy with gfifo_reserve/gfifo_acquire, and
+ * without any lock.
+ *
+ * Including this file before gfifo.h enables both modes. Every process
+ * using a segment must be built with the same gfifo.h modes; attach checks
+ * the layout and refuses a mismatching segment.
+ *
+ * Link with -lrt on C libraries older than glibc 2.34.
+ */
+
+#ifndef __GFIFO_SHM_H__
+#define __GFIFO_SHM_H__
+
+#if !defined(GFIFO_SELF_RELATIVE) || !defined(GFIFO_SPSC)
+#ifdef __GFIFO_H__
+#error "gfifo.h included without the shm modes, include gfifo_shm.h first"
+#endif
+#endif
+
+#ifndef GFIFO_SELF_RELATIVE
+#define GFIFO_SELF_RELATIVE
+#endif
+
+#ifndef GFIFO_SPSC
+#define GFIFO_SPSC
+#endif
+
+#include "gfifo.h"
+
+#ifdef GFIFO_TIMESTAMP
+#error "the stamp array and histogram are process local, build without them"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define GFIFO_SHM_MAGIC 0x67666d73 /* "gfms" */
+
+/**
+ * @brief Shared segment header, the buffer follows on the next page
+ */
+struct gfifo_shm
+{
+  struct gfifo fifo;
+  unsigned int magic;
+  unsigned int layout;
+  unsigned int elem_size;
+  unsigned long map_size;
+};
+
+/* gfifo.h modes that change how both sides interpret the fifo */
+#ifdef GFIFO_FREE_RUNNING
+#define __GFIFO_SHM_FREE_RUNNING 1
+#else
+#define __GFIFO_SHM_FREE_RUNNING 0
+#endif
+
+#ifdef GFIFO_WAIT
+#define __GFIFO_SHM_WAIT 2
+#else
+#define __GFIFO_SHM_WAIT 0
+#endif
+
+#ifdef GFIFO_OVERWRITE
+#define __GFIFO_SHM_OVERWRITE 4
+#else
+#define __GFIFO_SHM_OVERWRITE 0
+#endif
+
+#ifdef GFIFO_STATS
+#define __GFIFO_SHM_STATS 8
+#else
+#define __GFIFO_SHM_STATS 0
+#endif
+
+#ifdef GFIFO_ANY_SIZE
+#define __GFIFO_SHM_ANY_SIZE 16
+#else
+#define __GFIFO_SHM_ANY_SIZE 0
+#endif
+
+/* identifies sizeof (struct gfifo) and the modes in one word */
+#define __GFIFO_SHM_LAYOUT                                                    \
+  ((unsigned int)sizeof (struct gfifo)                                        \
+   | (__GFIFO_SHM_FREE_RUNNING | __GFIFO_SHM_WAIT | __GFIFO_SHM_OVERWRITE     \
+      | __GFIFO_SHM_STATS | __GFIFO_SHM_ANY_SIZE)                             \
+         << 16)
+
+/* without free running indices one slot stays empty */
+#define __GFIFO_SHM_MIN_SIZE (__GFIFO_SHM_FREE_RUNNING ? 1 : 2)
+
+static inline size_t
+__gfifo_shm_data_off (void)
+{
+  size_t page = sysconf (_SC_PAGESIZE);
+
+  return (sizeof (struct gfifo_shm) + page - 1) / page * page;
+}
+
+/**
+ * @brief create a fifo in a new shared memory segment
+ *
+ * @param[in] name: segment's name, as for shm_open
+ * @param[in] size: fifo's size, a power of two unless GFIFO_ANY_SIZE
+ * @param[in] elem_size: element's size, sizeof (_type)
+ *
+ * @retval:
+ *    \li fifo's address: success
+ *    \li NULL: failed, errno is set (EEXIST if the name is taken, EINVAL
+ *        for a bad size)
+ */
+static inline struct gfifo *
+gfifo_shm_create (const char *name, unsigned int size, size_t elem_size)
+{
+  size_t map_size = __gfifo_shm_data_off () + (size_t)size * elem_size;
+  struct gfifo_shm *shm;
+  int fd, err;
+
+#ifdef GFIFO_ANY_SIZE
+  if (size < __GFIFO_SHM_MIN_SIZE || !elem_size)
+#else
+  if (size < __GFIFO_SHM_MIN_SIZE || (size & (size - 1)) || !elem_size)
+#endif
+    {
+      errno = EINVAL;
+      return NULL;
+    }
+
+  fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0)
+    return NULL;
+  if (ftruncate (fd, map_size) < 0)
+    goto err_unlink;
+  shm = (struct gfifo_shm *)mmap (NULL, map_size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED, fd, 0);
+  if (shm == MAP_FAILED)
+    goto err_unlink;
+  close (fd);
+
+  gfifo_init (&shm->fifo, (char *)shm + __gfifo_shm_data_off (), size);
+  shm->layout = __GFIFO_SHM_LAYOUT;
+  shm->elem_size = elem_size;
+  shm->map_size = map_size;
+  /* attachers check magic last, publish it after everything else */
+  __atomic_store_n (&shm->magic, GFIFO_SHM_MAGIC, __ATOMIC_RELEASE);
+  return &shm->fifo;
+
+err_unlink:
+  err = errno;
+  shm_unlink (name);
+  close (fd);
+  errno = err;
+  return NULL;
+}
+
+/**
+ * @brief attach to a fifo created by gfifo_shm_create
+ *
+ * @param[in] name: segment's name, as for shm_open
+ * @param[in] elem_size: element's size, sizeof (_type)
+ *
+ * @retval:
+ *    \li fifo's address: success
+ *    \li NULL: failed, errno is set (EAGAIN if the creator has not
+ *        finished initializing it yet, EPROTO on a layout mismatch)
+ */
+static inline struct gfifo *
+gfifo_shm_attach (const char *name, size_t elem_size)
+{
+  struct gfifo_shm *shm;
+  struct stat st;
+  int fd, err = 0;
+
+  fd = shm_open (name, O_RDWR, 0);
+  if (fd < 0)
+    return NULL;
+  if (fstat (fd, &st) < 0)
+    goto err_close;
+  if ((size_t)st.st_size < __gfifo_shm_data_off ())
+    {
+      errno = EAGAIN;
+      goto err_close;
+    }
+  shm = (struct gfifo_shm *)mmap (NULL, st.st_size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED, fd, 0);
+  if (shm == MAP_FAILED)
+    goto err_close;
+  close (fd);
+
+  if (__atomic_load_n (&shm->magic, __ATOMIC_ACQUIRE) != GFIFO_SHM_MAGIC)
+    err = EAGAIN;
+  else if (shm->layout != __GFIFO_SHM_LAYOUT || shm->elem_size != elem_size
+           || shm->map_size != (unsigned long)st.st_size)
+    err = EPROTO;
+  if (err)
+    {
+      munmap (shm, st.st_size);
+      errno = err;
+      return NULL;
+    }
+  return &shm->fifo;
+
+err_close:
+  err = errno;
+  close (fd);
+  errno = err;
+  return NULL;
+}
+
+/**
+ * @brief unmap a fifo obtained from gfifo_shm_create or gfifo_shm_attach
+ *
+ * @param[in] fifo: fifo's address
+ */
+static inline void
+gfifo_shm_detach (struct gfifo *fifo)
+{
+  struct gfifo_shm *shm = (struct gfifo_shm *)fifo;
+
+  munmap (shm, shm->map_size);
+}
+
+/**
+ * @brief remove a segment's name, mappings stay valid until detached
+ *
+ * @param[in] name: segment's name, as for shm_open
+ *
+ * @retval:
+ *    \li 0: success
+ *    \li -1: failed, errno is set
+ */
+static inline int
+gfifo_shm_unlink (const char *name)
+{
+  return shm_unlink (name);
+}
+
+#endif /* __GFIFO_SHM_H__ */
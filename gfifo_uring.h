@@ -0,0 +1,539 @@
+/**
+ * @file gfifo_uring.h
+ * @brief io_uring file / socket sink and source stages for a fifo
+ * @author Disen Shaw
+ * @version V1.0.2
+ * @date 2026-10-14
+ *
+ * A sink drains a fifo into a file or socket without a staging copy: the
+ * stored elements are handed to the kernel in place, as IORING_OP_WRITEV
+ * over the one or two spans gfifo_readable_spans would return, and @c out
+ * only moves once a write has completed. Up to GFIFO_URING_DEPTH writes of
+ * at most GFIFO_URING_BATCH bytes are in flight at a time. A source is the
+ * mirror image: IORING_OP_READV straight into the free spans, committed
+ * when the read completes.
+ *
+ * Writes and reads may complete out of order; gfifo_uring_poll still moves
+ * the index over the oldest operations first, so the fifo stays in order.
+ * With an explicit file offset the operations are independent. With
+ * GFIFO_URING_STREAM (sockets, pipes, the current file position) they are
+ * linked so the kernel runs them in order; a short transfer cancels the
+ * rest of the chain, which is submitted again once the chain is done.
+ *
+ * A sink is the fifo's consumer and a source its producer. Both run from
+ * the thread calling gfifo_uring_poll, which never blocks unless asked to.
+ * The ring is set up with the raw system calls, no liburing is needed.
+ * Linux 5.6 or later.
+ */
+
+#ifndef __GFIFO_URING_H__
+#define __GFIFO_URING_H__
+
+#include "gfifo.h"
+
+#ifdef GFIFO_OVERWRITE
+#error "the producer would overwrite writes in flight, build without it"
+#endif
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* operations in flight per stage */
+#ifndef GFIFO_URING_DEPTH
+#define GFIFO_URING_DEPTH 8
+#endif
+
+/* bytes per operation, at least one element */
+#ifndef GFIFO_URING_BATCH
+#define GFIFO_URING_BATCH (64U << 10)
+#endif
+
+/* gfifo_uring_init offset for sockets, pipes and the current file position */
+#define GFIFO_URING_STREAM (-1LL)
+
+/* gfifo_uring_init directions */
+#define GFIFO_URING_SINK 0   /* fifo to fd */
+#define GFIFO_URING_SOURCE 1 /* fd to fifo */
+
+/* struct gfifo_uring_op states */
+#define __GFIFO_URING_INFLIGHT 0
+#define __GFIFO_URING_PENDING 1 /* to be submitted again for the rest */
+#define __GFIFO_URING_DONE 2
+
+/**
+ * @brief One write or read of up to two spans
+ */
+struct gfifo_uring_op
+{
+  struct iovec iov[2]; /* whole operation */
+  struct iovec cur[2]; /* what is left of it, as last submitted */
+  long long off;       /* file offset of iov[0], -1 for streams */
+  unsigned int elems;
+  unsigned int bytes;
+  unsigned int done; /* bytes transferred so far */
+  unsigned int state;
+  unsigned int discard; /* source only, lies past a short read */
+};
+
+/**
+ * @brief io_uring stage draining or filling one fifo
+ */
+struct gfifo_uring
+{
+  struct gfifo *fifo;
+  size_t esize;
+  int fd;
+  int ring_fd;
+  unsigned int source;
+  unsigned int stream;
+  unsigned int eof;
+  int err;            /* first error, sticky */
+  long long offset;   /* file offset of the next operation */
+  unsigned int next;  /* fifo index past the last element given to an op */
+  unsigned int batch; /* elements per operation */
+
+  /* operations, oldest first from head */
+  unsigned int head;
+  unsigned int cnt;
+  unsigned int inflight;
+  struct gfifo_uring_op ops[GFIFO_URING_DEPTH];
+
+  /* rings shared with the kernel */
+  unsigned int *sq_head;
+  unsigned int *sq_tail;
+  unsigned int *sq_mask;
+  unsigned int *sq_array;
+  struct io_uring_sqe *sqes;
+  unsigned int *cq_head;
+  unsigned int *cq_tail;
+  unsigned int *cq_mask;
+  struct io_uring_cqe *cqes;
+  void *sq_map;
+  void *cq_map;
+  size_t sq_size;
+  size_t cq_size;
+  size_t sqes_size;
+};
+
+static inline void
+__gfifo_uring_unmap (struct gfifo_uring *ur)
+{
+  if (ur->sqes && ur->sqes != MAP_FAILED)
+    munmap (ur->sqes, ur->sqes_size);
+  if (ur->cq_map && ur->cq_map != MAP_FAILED && ur->cq_map != ur->sq_map)
+    munmap (ur->cq_map, ur->cq_size);
+  if (ur->sq_map && ur->sq_map != MAP_FAILED)
+    munmap (ur->sq_map, ur->sq_size);
+  close (ur->ring_fd);
+}
+
+static inline int
+__gfifo_uring_setup (struct gfifo_uring *ur, unsigned int entries)
+{
+  struct io_uring_params p;
+  int err;
+
+  memset (&p, 0, sizeof (p));
+  ur->ring_fd = (int)syscall (__NR_io_uring_setup, entries, &p);
+  if (ur->ring_fd < 0)
+    return -1;
+
+  ur->sq_size = p.sq_off.array + p.sq_entries * sizeof (unsigned int);
+  ur->cq_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+      if (ur->cq_size > ur->sq_size)
+        ur->sq_size = ur->cq_size;
+      ur->cq_size = ur->sq_size;
+    }
+  ur->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+  ur->sq_map = NULL;
+  ur->cq_map = NULL;
+  ur->sqes = NULL;
+
+  ur->sq_map = mmap (NULL, ur->sq_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ur->ring_fd,
+                     IORING_OFF_SQ_RING);
+  if (ur->sq_map == MAP_FAILED)
+    goto err_unmap;
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    ur->cq_map = ur->sq_map;
+  else
+    ur->cq_map = mmap (NULL, ur->cq_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ur->ring_fd,
+                       IORING_OFF_CQ_RING);
+  if (ur->cq_map == MAP_FAILED)
+    goto err_unmap;
+  ur->sqes = (struct io_uring_sqe *)mmap (NULL, ur->sqes_size,
+                                          PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE,
+                                          ur->ring_fd, IORING_OFF_SQES);
+  if (ur->sqes == MAP_FAILED)
+    goto err_unmap;
+
+  ur->sq_head = (unsigned int *)((char *)ur->sq_map + p.sq_off.head);
+  ur->sq_tail = (unsigned int *)((char *)ur->sq_map + p.sq_off.tail);
+  ur->sq_mask = (unsigned int *)((char *)ur->sq_map + p.sq_off.ring_mask);
+  ur->sq_array = (unsigned int *)((char *)ur->sq_map + p.sq_off.array);
+  ur->cq_head = (unsigned int *)((char *)ur->cq_map + p.cq_off.head);
+  ur->cq_tail = (unsigned int *)((char *)ur->cq_map + p.cq_off.tail);
+  ur->cq_mask = (unsigned int *)((char *)ur->cq_map + p.cq_off.ring_mask);
+  ur->cqes = (struct io_uring_cqe *)((char *)ur->cq_map + p.cq_off.cqes);
+  return 0;
+
+err_unmap:
+  err = errno;
+  __gfifo_uring_unmap (ur);
+  errno = err;
+  return -1;
+}
+
+/**
+ * @brief set up a sink or source stage on a fifo
+ *
+ * @param[out] ur: stage
+ * @param[inout] fifo: fifo the stage consumes (sink) or produces (source)
+ * @param[in] esize: element's size
+ * @param[in] fd: file or socket
+ * @param[in] offset: file offset of the first byte, or GFIFO_URING_STREAM
+ * @param[in] source: GFIFO_URING_SINK or GFIFO_URING_SOURCE
+ *
+ * @retval:
+ *    \li 0: success
+ *    \li -1: failed, errno is set
+ */
+static inline int
+gfifo_uring_init (struct gfifo_uring *ur, struct gfifo *fifo, size_t esize,
+                  int fd, long long offset, unsigned int source)
+{
+  memset (ur, 0, sizeof (*ur));
+  ur->fifo = fifo;
+  ur->esize = esize;
+  ur->fd = fd;
+  ur->source = source;
+  ur->stream = offset < 0;
+  ur->offset = offset;
+  ur->next = source ? fifo->in : fifo->out;
+  ur->batch = GFIFO_URING_BATCH / esize ? GFIFO_URING_BATCH / esize : 1;
+  return __gfifo_uring_setup (ur, GFIFO_URING_DEPTH);
+}
+
+/* queue op's remaining bytes as one SQE, the kernel reads it on enter */
+static inline struct io_uring_sqe *
+__gfifo_uring_prep (struct gfifo_uring *ur, struct gfifo_uring_op *op)
+{
+  unsigned int tail = *ur->sq_tail, idx = tail & *ur->sq_mask;
+  struct io_uring_sqe *sqe = &ur->sqes[idx];
+  size_t skip = op->done;
+  unsigned int i, n = 0;
+
+  for (i = 0; i < 2; i++)
+    {
+      if (skip >= op->iov[i].iov_len)
+        {
+          skip -= op->iov[i].iov_len;
+          continue;
+        }
+      op->cur[n].iov_base = (char *)op->iov[i].iov_base + skip;
+      op->cur[n].iov_len = op->iov[i].iov_len - skip;
+      skip = 0;
+      n++;
+    }
+
+  memset (sqe, 0, sizeof (*sqe));
+  sqe->opcode = ur->source ? IORING_OP_READV : IORING_OP_WRITEV;
+  sqe->fd = ur->fd;
+  sqe->addr = (unsigned long)op->cur;
+  sqe->len = n;
+  sqe->off = op->off < 0 ? (__u64)-1 : (__u64)(op->off + op->done);
+  sqe->user_data = op - ur->ops;
+  if (ur->stream)
+    sqe->flags = IOSQE_IO_LINK;
+  ur->sq_array[idx] = idx;
+  __atomic_store_n (ur->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+  op->state = __GFIFO_URING_INFLIGHT;
+  ur->inflight++;
+  return sqe;
+}
+
+/* queue retries and new operations, streams only while nothing is queued */
+static inline void
+__gfifo_uring_fill (struct gfifo_uring *ur)
+{
+  struct gfifo *fifo = ur->fifo;
+  struct io_uring_sqe *last = NULL;
+  struct gfifo_uring_op *op;
+  unsigned int i, cnt, off, run;
+
+  if (ur->err || (ur->stream && ur->inflight))
+    return;
+
+  for (i = 0; i < ur->cnt; i++)
+    {
+      op = &ur->ops[(ur->head + i) % GFIFO_URING_DEPTH];
+      if (op->state == __GFIFO_URING_PENDING && !op->discard)
+        last = __gfifo_uring_prep (ur, op);
+    }
+
+  while (ur->cnt < GFIFO_URING_DEPTH && !ur->eof)
+    {
+      if (ur->source)
+        cnt = __gfifo_capacity (fifo)
+              - __gfifo_used (fifo, ur->next,
+                              __gfifo_load_acquire (fifo->out));
+      else
+        cnt = __gfifo_used (fifo, __gfifo_load_acquire (fifo->in), ur->next);
+      if (!cnt)
+        break;
+      if (cnt > ur->batch)
+        cnt = ur->batch;
+
+      op = &ur->ops[(ur->head + ur->cnt) % GFIFO_URING_DEPTH];
+      off = __gfifo_idx (fifo, ur->next);
+      run = __gfifo_first_run (fifo, off, cnt);
+      op->iov[0].iov_base = (char *)__gfifo_data (fifo) + off * ur->esize;
+      op->iov[0].iov_len = run * ur->esize;
+      op->iov[1].iov_base = __gfifo_data (fifo);
+      op->iov[1].iov_len = (cnt - run) * ur->esize;
+      op->elems = cnt;
+      op->bytes = cnt * ur->esize;
+      op->done = 0;
+      op->discard = 0;
+      op->off = ur->stream ? -1 : ur->offset;
+      if (!ur->stream)
+        ur->offset += op->bytes;
+      ur->next = __gfifo_next (fifo, ur->next, cnt);
+      ur->cnt++;
+      last = __gfifo_uring_prep (ur, op);
+    }
+
+  /* end of the chain */
+  if (last)
+    last->flags &= ~IOSQE_IO_LINK;
+}
+
+static inline void
+__gfifo_uring_complete (struct gfifo_uring *ur, struct gfifo_uring_op *op,
+                        int res)
+{
+  unsigned int i;
+
+  ur->inflight--;
+  if (res > 0)
+    op->done += res;
+  if (op->discard || op->done == op->bytes)
+    {
+      op->state = __GFIFO_URING_DONE;
+      return;
+    }
+  if (res < 0 && res != -ECANCELED && res != -EINTR && res != -EAGAIN)
+    {
+      if (!ur->err)
+        ur->err = -res;
+      op->state = __GFIFO_URING_PENDING;
+      return;
+    }
+
+  /* end of file, or a short stream read that ends on an element */
+  if (ur->source
+      && (res == 0 || (ur->stream && res > 0 && op->done % ur->esize == 0)))
+    {
+      if (res == 0)
+        ur->eof = 1;
+      op->state = __GFIFO_URING_DONE;
+      /* the next reads no longer start where this one stopped */
+      for (i = (op - ur->ops + 1) % GFIFO_URING_DEPTH;
+           i != (ur->head + ur->cnt) % GFIFO_URING_DEPTH;
+           i = (i + 1) % GFIFO_URING_DEPTH)
+        ur->ops[i].discard = 1;
+      return;
+    }
+  op->state = __GFIFO_URING_PENDING;
+}
+
+/* move the fifo's index over the oldest finished operations */
+static inline unsigned int
+__gfifo_uring_advance (struct gfifo_uring *ur)
+{
+  struct gfifo_uring_op *op;
+  unsigned int moved = 0, n;
+
+  while (ur->cnt)
+    {
+      op = &ur->ops[ur->head];
+      if (op->state == __GFIFO_URING_INFLIGHT
+          || (op->state == __GFIFO_URING_PENDING && !op->discard))
+        break;
+      if (!op->discard)
+        {
+          if (ur->source)
+            {
+              n = op->done / ur->esize;
+              gfifo_commit_n (ur->fifo, n);
+            }
+          else
+            {
+              n = op->elems;
+              gfifo_release_n (ur->fifo, n);
+            }
+          moved += n;
+        }
+      ur->head = (ur->head + 1) % GFIFO_URING_DEPTH;
+      ur->cnt--;
+    }
+  /* after a short read the next op starts at the first free slot again */
+  if (!ur->cnt && ur->source)
+    ur->next = ur->fifo->in;
+  return moved;
+}
+
+static inline void
+__gfifo_uring_reap (struct gfifo_uring *ur)
+{
+  unsigned int head = *ur->cq_head;
+  unsigned int tail = __atomic_load_n (ur->cq_tail, __ATOMIC_ACQUIRE);
+  struct io_uring_cqe *cqe;
+
+  for (; head != tail; head++)
+    {
+      cqe = &ur->cqes[head & *ur->cq_mask];
+      __gfifo_uring_complete (ur, &ur->ops[cqe->user_data], cqe->res);
+    }
+  __atomic_store_n (ur->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief reap completions, move the fifo's index and submit new operations
+ *
+ * @param[inout] ur: stage
+ * @param[in] wait: 1 to block until an operation in flight completes
+ *
+ * @retval:
+ *    \li number of elements written (sink) or read (source): success
+ *    \li -1: failed, errno is set; operations still in flight complete
+ *        on later calls
+ */
+static inline long
+gfifo_uring_poll (struct gfifo_uring *ur, unsigned int wait)
+{
+  unsigned int moved, submit, min;
+
+  __gfifo_uring_reap (ur);
+  moved = __gfifo_uring_advance (ur);
+
+  __gfifo_uring_fill (ur);
+  submit = *ur->sq_tail - __atomic_load_n (ur->sq_head, __ATOMIC_ACQUIRE);
+  min = wait && ur->inflight ? 1 : 0;
+  if ((submit || min)
+      && syscall (__NR_io_uring_enter, ur->ring_fd, submit, min,
+                  min ? IORING_ENTER_GETEVENTS : 0, NULL, 0)
+             < 0
+      && errno != EINTR && errno != EAGAIN && errno != EBUSY && !ur->err)
+    ur->err = errno;
+
+  __gfifo_uring_reap (ur);
+  moved += __gfifo_uring_advance (ur);
+  if (ur->err)
+    {
+      errno = ur->err;
+      return -1;
+    }
+  return moved;
+}
+
+/**
+ * @brief wait for a stage to catch up
+ *
+ * A sink returns once every element stored at the call has been written,
+ * a source once every read in flight has been committed.
+ *
+ * @param[inout] ur: stage
+ *
+ * @retval:
+ *    \li 0: success
+ *    \li -1: failed, errno is set
+ */
+static inline int
+gfifo_uring_flush (struct gfifo_uring *ur)
+{
+  unsigned int left = 0;
+  long n;
+
+  if (!ur->source)
+    left = __gfifo_used (ur->fifo, __gfifo_load_acquire (ur->fifo->in),
+                         ur->fifo->out);
+  while (ur->source ? ur->inflight : left)
+    {
+      n = gfifo_uring_poll (ur, 1);
+      if (n < 0)
+        return -1;
+      left = (unsigned long)n >= left ? 0 : left - n;
+    }
+  return 0;
+}
+
+/**
+ * @brief tell whether a source hit the end of its file or stream
+ *
+ * @param[in] ur: stage
+ */
+#define gfifo_uring_eof(ur) ((ur)->eof)
+
+/**
+ * @brief wait for the operations in flight and release the ring
+ *
+ * Elements the sink did not write yet stay in the fifo.
+ *
+ * @param[inout] ur: stage
+ */
+static inline void
+gfifo_uring_deinit (struct gfifo_uring *ur)
+{
+  /* the kernel may still be using the fifo's buffer */
+  while (ur->inflight)
+    gfifo_uring_poll (ur, 1);
+  __gfifo_uring_unmap (ur);
+}
+
+/**
+ * @brief set up a stage writing a fifo's elements to a file or socket
+ *
+ * @param[out] _ur: stage
+ * @param[inout] _fifo: fifo's address, the stage is its consumer
+ * @param[in] _fd: file or socket
+ * @param[in] _offset: file offset, or GFIFO_URING_STREAM
+ * @param[in] _type: element's type
+ *
+ * @retval:
+ *    \li 0: success
+ *    \li -1: failed, errno is set
+ */
+#define gfifo_uring_sink_init(_ur, _fifo, _fd, _offset, _type)                \
+  gfifo_uring_init (_ur, _fifo, sizeof (_type), _fd, _offset,                 \
+                    GFIFO_URING_SINK)
+
+/**
+ * @brief set up a stage filling a fifo from a file or socket
+ *
+ * @param[out] _ur: stage
+ * @param[inout] _fifo: fifo's address, the stage is its producer
+ * @param[in] _fd: file or socket
+ * @param[in] _offset: file offset, or GFIFO_URING_STREAM
+ * @param[in] _type: element's type
+ *
+ * @retval:
+ *    \li 0: success
+ *    \li -1: failed, errno is set
+ */
+#define gfifo_uring_source_init(_ur, _fifo, _fd, _offset, _type)              \
+  gfifo_uring_init (_ur, _fifo, sizeof (_type), _fd, _offset,                 \
+                    GFIFO_URING_SOURCE)
+
+#endif /* __GFIFO_URING_H__ */